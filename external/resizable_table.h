@@ -63,7 +63,10 @@ class resizable_table {
   void insert(K k) {
     size_t h = firstIndex(k);
     while (true) {
-      if (table[h] == empty && atomic_compare_and_swap(&table[h], empty, k)) {
+      // Slots of 64-bit id pairs are written in two stores, so they are read
+      // with atomic_read while other workers insert
+      if (atomic_read(&table[h]) == empty &&
+          atomic_compare_and_swap(&table[h], empty, k)) {
         return;
       }
       h = incrementIndex(h, mask);
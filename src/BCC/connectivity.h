@@ -10,9 +10,13 @@ using namespace parlay;
 template<class NodeId>
 struct hash_k {
   uint64_t operator()(const pair<NodeId, NodeId> &k) {
-    uint64_t v = k.first;
-    v = (v << 32) | (k.second);
-    return parlay::hash64(v);
+    if constexpr (sizeof(NodeId) <= 4) {
+      uint64_t v = k.first;
+      v = (v << 32) | (k.second);
+      return parlay::hash64(v);
+    } else {
+      return parlay::hash64(parlay::hash64(k.first) ^ k.second);
+    }
   }
 };
 
@@ -5,6 +5,13 @@
 
 #include "graph.h"
 
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
+typedef uint32_t NodeId;
+#endif
+typedef uint64_t EdgeId;
+
 constexpr int NUM_ROUND = 5;
 
 template <class Algo, class Graph>
@@ -73,7 +80,7 @@ int main(int argc, char *argv[]) {
   }
 
   printf("Reading graph...\n");
-  Graph G;
+  Graph<NodeId, EdgeId> G;
   G.read_graph(input_path);
   G.symmetrized = symmetrized;
 
@@ -3,12 +3,15 @@
 #include <cmath>
 #include <iostream>
 
+#include "bitmap.h"
 #include "graph.h"
 #include "hashbag.h"
+#include "neighbor_scan.h"
 #include "parlay/parallel.h"
 #include "parlay/random.h"
 #include "parlay/sequence.h"
 #include "parlay/primitives.h"
+#include "prefetch.h"
 
 using namespace std;
 using namespace parlay;
@@ -26,25 +29,26 @@ class LDD {
  private:
   const Graph& G;
   sequence<NodeId> frontier;
-  sequence<bool> in_frontier;
-  sequence<bool> in_next_frontier;
+  bitmap in_frontier;
+  bitmap in_next_frontier;
   hashbag<NodeId> bag;
   bool sparse;
   size_t frontier_size;
   size_t threshold;
   function<bool(NodeId, NodeId)> pred;
+  // sparse rounds prefetch the neighbors of the frontier this many vertices
+  // ahead (see prefetch.h)
+  size_t prefetch_distance;
 
   size_t sparse_update(sequence<NodeId>& label, sequence<NodeId>& parent) {
-    parallel_for(
-        0, frontier_size,
-        [&](size_t i) {
-          NodeId f = frontier[i];
-          size_t deg_f = G.offsets[f + 1] - G.offsets[f];
+    for_each_prefetched(
+        G, frontier, frontier_size, label.data(), prefetch_distance,
+        [&](NodeId f) {
+          size_t deg_f = G.degree(f);
           if (deg_f > BLOCK_SIZE) {
-            parallel_for(
-                G.offsets[f], G.offsets[f + 1],
-                [&](size_t j) {
-                  NodeId v = G.edges[j].v;
+            G.map_neighbors_parallel(
+                f,
+                [&](NodeId v, auto) {
                   if (pred(f, v)) {
                     if (compare_and_swap(&label[v], NODE_MAX, label[f])) {
                       if (parent.size()) {
@@ -61,12 +65,11 @@ class LDD {
             local_queue[tail++] = f;
             while (head < tail && tail != LOCAL_QUEUE_SIZE) {
               NodeId u = local_queue[head++];
-              size_t deg_u = G.offsets[u + 1] - G.offsets[u];
+              size_t deg_u = G.degree(u);
               if (deg_u > BLOCK_SIZE) {
                 bag.insert(u);
               } else {
-                for (size_t j = G.offsets[u]; j < G.offsets[u + 1]; j++) {
-                  NodeId v = G.edges[j].v;
+                G.map_neighbors(u, [&](NodeId v, auto) {
                   if (pred(u, v)) {
                     if (compare_and_swap(&label[v], NODE_MAX, label[u])) {
                       if (parent.size()) {
@@ -79,7 +82,7 @@ class LDD {
                       }
                     }
                   }
-                }
+                });
               }
             }
             for (size_t j = head; j < tail; j++) {
@@ -91,34 +94,35 @@ class LDD {
     return bag.pack_into(make_slice(frontier));
   }
 
+  // Every word of the frontiers is updated by one thread, 64 vertices at a
+  // time
   size_t dense_update(sequence<NodeId>& label, sequence<NodeId>& parent) {
-    parallel_for(
-        0, G.n,
-        [&](NodeId i) {
-          in_next_frontier[i] = false;
-          if (label[i] == NODE_MAX) {
-            const auto& offsets = G.symmetrized ? G.offsets : G.in_offsets;
-            const auto& edges = G.symmetrized ? G.edges : G.in_edges;
-            for (size_t j = offsets[i]; j < offsets[i + 1]; j++) {
-              NodeId v = edges[j].v;
-              if (pred(i, v)) {
-                if (in_frontier[v]) {
-                  if (parent.size()) {
-                    parent[i] = v;
-                  }
-                  label[i] = label[v];
-                  in_frontier[i] = in_next_frontier[i] = true;
-                  break;
-                }
-              }
+    parallel_for(0, in_frontier.num_words(), [&](size_t w) {
+      uint64_t next = 0;
+      size_t end = min((w + 1) * bitmap::WORD_BITS, G.n);
+      for (NodeId i = w * bitmap::WORD_BITS; i < end; i++) {
+        if (label[i] == NODE_MAX) {
+          uint64_t bit = uint64_t{1} << (i % bitmap::WORD_BITS);
+          prefetch_in_neighbors(G, i + 1);
+          scan_in_neighbors_in(G, i, in_frontier, [&](NodeId v) {
+            if (!pred(i, v)) {
+              return false;
             }
-          }
-        },
-        BLOCK_SIZE);
+            if (parent.size()) {
+              parent[i] = v;
+            }
+            label[i] = label[v];
+            in_frontier.word(w) |= bit;
+            next |= bit;
+            return true;
+          });
+        }
+      }
+      in_next_frontier.word(w) = next;
+    });
 
     swap(in_frontier, in_next_frontier);
-    auto ret = count(in_frontier, true);
-    return ret;
+    return in_frontier.count();
   }
 
   EdgeId dense_sample(NodeId seed) {
@@ -129,24 +133,21 @@ class LDD {
     while (count < NUM_SAMPLES) {
       i++;
       NodeId index = hash32(seed + i) % G.n;
-      if (in_frontier[index]) {
+      if (in_frontier.get(index)) {
         count++;
-        out_edges += G.offsets[index + 1] - G.offsets[index];
+        out_edges += G.degree(index);
       }
     }
     return frontier_size * (out_edges / count);
   }
 
   void sparse2dense() {
-    parallel_for(0, G.n, [&](size_t i) { in_frontier[i] = false; });
+    in_frontier.clear();
     parallel_for(0, frontier_size,
-                 [&](size_t i) { in_frontier[frontier[i]] = true; });
+                 [&](size_t i) { in_frontier.set(frontier[i]); });
   }
 
-  void dense2sparse() {
-    auto identity = delayed_seq<NodeId>(G.n, [&](size_t i) { return i; });
-    pack_into_uninitialized(identity, in_frontier, frontier);
-  }
+  void dense2sparse() { in_frontier.pack_into(frontier); }
 
   bool judge(int round) {
     size_t front_out_edges = 0;
@@ -158,7 +159,7 @@ class LDD {
     if (sparse || both_sparse_dense) {
       auto degree_seq = delayed_seq<size_t>(frontier_size, [&](size_t i) {
         NodeId u = frontier[i];
-        return G.offsets[u + 1] - G.offsets[u];
+        return G.degree(u);
       });
       front_out_edges = reduce(degree_seq);
     } else {
@@ -182,33 +183,50 @@ class LDD {
                            [](NodeId, NodeId) { return true; })
       : G(_G), bag(G.n), pred(_pred) {
     frontier = sequence<NodeId>(G.n);
-    in_frontier = sequence<bool>::uninitialized(G.n);
-    in_next_frontier = sequence<bool>::uninitialized(G.n);
+    in_frontier = bitmap(G.n);
+    in_next_frontier = bitmap(G.n);
     sparse = true;
     frontier_size = 0;
     threshold = G.m / 20;
+    prefetch_distance = PREFETCH_DISTANCE;
   };
 
-  tuple<sequence<NodeId>, sequence<NodeId>> ldd(double beta,
-                                                bool spanning_tree = false) {
+  // 0 turns the prefetching of sparse rounds off
+  void set_prefetch_distance(size_t d) { prefetch_distance = d; }
+
+  // Centers are drawn from num_samples random vertices. The default suffices
+  // for connectivity; use G.n to get clusters of diameter O(log n / beta).
+  tuple<sequence<NodeId>, sequence<NodeId>> ldd(
+      double beta, bool spanning_tree = false,
+      size_t num_samples = NUM_SAMPLES) {
     size_t n = G.n;
     sequence<NodeId> label(n, NODE_MAX);
     sequence<NodeId> parent;
     if (spanning_tree) {
       parent = tabulate(n, [&](NodeId i) { return i; });
     }
-    sequence<NodeId> perm = sequence<NodeId>(NUM_SAMPLES);
-    for (size_t i = 0; i < NUM_SAMPLES; i++) {
-      perm[i] = hash32(NUM_SAMPLES + i) % n;
+    sequence<NodeId> perm;
+    if (num_samples < n) {
+      perm = tabulate(num_samples, [&](size_t i) -> NodeId {
+        return hash32(NUM_SAMPLES + i) % n;
+      });
+    } else {
+      // every vertex once, in random order
+      num_samples = n;
+      perm = tabulate(n, [&](size_t i) -> NodeId { return i; });
+      sort_inplace(perm, [&](NodeId u, NodeId v) {
+        uint32_t hu = hash32(u), hv = hash32(v);
+        return hu < hv || (hu == hv && u < v);
+      });
     }
     size_t num_sampled = 0;
     int round = 0;
     frontier_size = 0;
     sparse = true;
-    while (frontier_size > 0 || num_sampled < NUM_SAMPLES) {
+    while (frontier_size > 0 || num_sampled < num_samples) {
       round++;
       size_t step_size = floor(exp(round * beta));
-      size_t work_size = min(step_size, NUM_SAMPLES - num_sampled);
+      size_t work_size = min(step_size, num_samples - num_sampled);
       size_t num_new_centers = 0;
       if (sparse && work_size > 0) {
         auto centers = filter(perm.cut(num_sampled, num_sampled + work_size),
@@ -225,7 +243,7 @@ class LDD {
           NodeId u = perm[i];
           if (label[u] == NODE_MAX) {
             label[u] = u;
-            in_frontier[u] = true;
+            in_frontier.set(u);
           }
         });
       }
@@ -35,12 +35,12 @@ Forest<NodeId> spanning_forest(
                                              get<1>(label_edge[i - 1]));
   });
   F.G.n = scan_inplace(first_edge);
-  F.G.offsets = sequence<NodeId>::uninitialized(F.G.n + 1);
+  auto graph_offsets = sequence<NodeId>::uninitialized(F.G.n + 1);
   F.offsets = sequence<NodeId>::uninitialized(F.num_trees + 1);
   F.vertex = sequence<NodeId>::uninitialized(F.G.n);
   parallel_for(0, label_edge.size(), [&](size_t i) {
     if (i == 0 || get<1>(label_edge[i]) != get<1>(label_edge[i - 1])) {
-      F.G.offsets[first_edge[i]] = i;
+      graph_offsets[first_edge[i]] = i;
       F.vertex[first_edge[i]] = get<1>(label_edge[i]);
     }
   });
@@ -51,10 +51,12 @@ Forest<NodeId> spanning_forest(
   });
   F.offsets[F.num_trees] = F.G.n;
   F.G.m = label_edge.size();
-  F.G.offsets[F.G.n] = F.G.m;
+  graph_offsets[F.G.n] = F.G.m;
+  F.G.offsets = std::move(graph_offsets);
 
   using Edge = WEdge<NodeId, Empty>;
-  F.G.edges = sequence<Edge>::uninitialized(label_edge.size());
-  parallel_for(0, F.G.m, [&](size_t i) { F.G.edges[i].v = get<2>(label_edge[i]); });
+  auto graph_edges = sequence<Edge>::uninitialized(label_edge.size());
+  parallel_for(0, F.G.m, [&](size_t i) { graph_edges[i].v = get<2>(label_edge[i]); });
+  F.G.edges = std::move(graph_edges);
   return F;
 }
\ No newline at end of file
@@ -97,19 +97,21 @@ class Tarjan_Vishkin : public BCC<Graph> {
     GA.n = edgelist.size();
     GA.m = sym_edges.size();
     using Edge = WEdge<NodeId, Empty>;
-    GA.offsets = sequence<EdgeId>(GA.n + 1, GA.m);
-    GA.edges = sequence<Edge>::uninitialized(GA.m);
+    auto ga_offsets = sequence<EdgeId>(GA.n + 1, GA.m);
+    auto ga_edges = sequence<Edge>::uninitialized(GA.m);
     parallel_for(0, GA.m, [&](size_t i) {
       NodeId u = sym_edges[i].first;
       NodeId v = sym_edges[i].second;
-      GA.edges[i].v = v;
+      ga_edges[i].v = v;
       if (i == 0 || sym_edges[i - 1].first != u) {
-        GA.offsets[u] = i;
+        ga_offsets[u] = i;
       }
     });
     parlay::scan_inclusive_inplace(
-        parlay::make_slice(GA.offsets.rbegin(), GA.offsets.rend()),
+        parlay::make_slice(ga_offsets.rbegin(), ga_offsets.rend()),
         parlay::minm<EdgeId>());
+    GA.offsets = std::move(ga_offsets);
+    GA.edges = std::move(ga_edges);
     auto label = get<0>(connectivity(GA, beta));
     return label;
   }
@@ -0,0 +1,109 @@
+#pragma once
+#include <climits>
+
+#include "graph.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+
+using namespace std;
+using namespace parlay;
+
+// Checks a BFS tree from s with the rules of the Graph500 validator:
+//  1. parent[s] == s, and the parents of the other vertices reached by the
+//     search lead to s without cycles
+//  2. the levels of the tree are the distances found by the search, so tree
+//     edges join consecutive levels
+//  3. every edge from a vertex in the tree leads to a vertex in the tree at
+//     most one level deeper
+//  4. the tree spans the vertices reachable from s (implied by 3)
+//  5. every tree edge is an edge of the graph
+// The levels of the tree are computed from the parents by pointer jumping, and
+// unreached vertices have parent and dist DIST_MAX. Rule 5 looks up parents
+// among in-neighbors, so directed graphs need their in-CSR. Prints the rules
+// that are violated and returns whether all of them hold.
+template <class Graph, class NodeId = typename Graph::NodeId>
+bool validate_bfs_tree(const Graph &G, NodeId s, const sequence<NodeId> &parent,
+                       const sequence<NodeId> &dist) {
+  constexpr NodeId DIST_MAX = numeric_limits<NodeId>::max();
+  size_t n = G.n;
+  auto in_tree = [&](NodeId v) { return parent[v] != DIST_MAX; };
+  auto count = [&](auto &&f) {
+    return reduce(delayed_seq<size_t>(n, [&](NodeId v) -> size_t {
+      return f(v) ? 1 : 0;
+    }));
+  };
+  bool valid = true;
+  auto check = [&](size_t violations, const char *rule) {
+    if (violations) {
+      printf("Validation failed: %zu vertices violate: %s\n", violations, rule);
+      valid = false;
+    }
+  };
+
+  // Rule 1
+  if (parent[s] != s || dist[s] != 0) {
+    printf("Validation failed: source %zu is not the root\n", (size_t)s);
+    return false;
+  }
+  size_t bad_parents = count([&](NodeId v) {
+    return in_tree(v) && (parent[v] >= n || !in_tree(parent[v]) ||
+                          (dist[v] == DIST_MAX));
+  });
+  check(bad_parents, "parent outside the tree");
+  if (bad_parents) {
+    return false;
+  }
+  // hops[v] is the length of the path from v to ancestor[v]
+  auto ancestor = tabulate(n, [&](NodeId v) { return parent[v]; });
+  auto hops = tabulate(n, [&](NodeId v) -> size_t {
+    return in_tree(v) && v != s ? 1 : 0;
+  });
+  for (size_t i = 0; i <= (size_t)log2_up(n); i++) {
+    auto next_ancestor = tabulate(n, [&](NodeId v) {
+      return in_tree(v) ? ancestor[ancestor[v]] : DIST_MAX;
+    });
+    auto next_hops = tabulate(n, [&](NodeId v) -> size_t {
+      return in_tree(v) ? hops[v] + hops[ancestor[v]] : 0;
+    });
+    ancestor = std::move(next_ancestor);
+    hops = std::move(next_hops);
+  }
+  check(count([&](NodeId v) { return in_tree(v) && ancestor[v] != s; }),
+        "parents do not lead to the source");
+
+  // Rule 2
+  check(count([&](NodeId v) {
+          return in_tree(v) ? ancestor[v] == s && hops[v] != dist[v]
+                            : dist[v] != DIST_MAX;
+        }),
+        "tree level differs from the distance");
+
+  // Rules 3 and 4
+  check(count([&](NodeId u) {
+          bool bad = false;
+          if (in_tree(u)) {
+            G.map_neighbors(u, [&](NodeId v, auto) {
+              if (!in_tree(v) || dist[v] > dist[u] + 1) {
+                bad = true;
+              }
+            });
+          }
+          return bad;
+        }),
+        "edge leaves the tree or skips a level");
+
+  // Rule 5
+  check(count([&](NodeId v) {
+          if (!in_tree(v) || v == s) {
+            return false;
+          }
+          bool found = false;
+          G.map_in_neighbors_until(v, [&](NodeId u, auto) {
+            found = u == parent[v];
+            return found;
+          });
+          return !found;
+        }),
+        "tree edge is not in the graph");
+  return valid;
+}
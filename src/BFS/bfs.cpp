@@ -2,20 +2,52 @@
 
 #include <queue>
 
+#include "bfs-validator.h"
+#include "bidirectional-bfs.h"
+#include "compressed_graph.h"
 #include "graph.h"
+#include "reorder.h"
 #include "seq-bfs.h"
 
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
+typedef uint32_t NodeId;
+#endif
+typedef uint64_t EdgeId;
+constexpr NodeId NO_SOURCE = numeric_limits<NodeId>::max();
 constexpr int NUM_SRC = 5;
 constexpr int NUM_ROUND = 5;
 
-template <class Algo, class Graph, class NodeId = typename Graph::NodeId>
-void run(Algo &algo, const Graph &G, bool verify, NodeId s) {
-  printf("source %-10d\n", s);
+// source, or NUM_SRC random sources if source is NO_SOURCE
+template <class Graph>
+sequence<NodeId> get_sources(const Graph &G, NodeId source) {
+  sequence<NodeId> sources;
+  if (source == NO_SOURCE) {
+    for (int v = 0; v < NUM_SRC; v++) {
+      sources.push_back(hash32(v) % G.n);
+    }
+  } else {
+    sources.push_back(source);
+  }
+  return sources;
+}
+
+// Returns the average time and the TEPS of the searches from s. With tree,
+// the searches also compute BFS parents.
+template <class Algo, class Graph>
+pair<double, double> run(Algo &algo, const Graph &G, bool verify, bool tree,
+                         NodeId s) {
+  printf("source %-10zu\n", static_cast<size_t>(s));
   double total_time = 0;
-  sequence<NodeId> dist;
+  sequence<NodeId> dist, parent;
   for (int i = 0; i <= NUM_ROUND; i++) {
     internal::timer t;
-    dist = algo.bfs(s);
+    if (tree) {
+      tie(dist, parent) = algo.bfs_tree(s);
+    } else {
+      dist = algo.bfs(s);
+    }
     t.stop();
     if (i == 0) {
       printf("Warmup Round: %f\n", t.total_time());
@@ -27,8 +59,19 @@ void run(Algo &algo, const Graph &G, bool verify, NodeId s) {
   double average_time = total_time / NUM_ROUND;
   printf("Average time: %f\n", average_time);
 
+  // As in Graph500, the traversed edges are the edges of the reached
+  // vertices, and each undirected edge counts once
+  size_t traversed_edges = reduce(delayed_seq<size_t>(G.n, [&](size_t v) {
+    return dist[v] != numeric_limits<NodeId>::max() ? G.degree(v) : 0;
+  }));
+  if (G.symmetrized) {
+    traversed_edges /= 2;
+  }
+  double teps = traversed_edges / average_time;
+  printf("TEPS: %e (%zu edges)\n", teps, traversed_edges);
+
   ofstream ofs("bfs.tsv", ios_base::app);
-  ofs << s << '\t' << average_time << '\n';
+  ofs << s << '\t' << average_time << '\t' << teps << '\n';
   ofs.close();
 
   if (verify) {
@@ -36,37 +79,233 @@ void run(Algo &algo, const Graph &G, bool verify, NodeId s) {
     Seq_BFS verifier(G);
     auto exp_dist = verifier.bfs(s);
     assert(dist == exp_dist);
+    if (tree && !validate_bfs_tree(G, s, parent, dist)) {
+      abort();
+    }
     printf("Passed!\n");
   }
   printf("\n");
+  return {average_time, teps};
 }
 
+// Runs from source, or from NUM_SRC random sources if source is NO_SOURCE, and
+// returns the average time. Sources are original ids, renamed by rank if G is
+// a relabeled graph. Like Graph500, also reports the harmonic mean of the
+// TEPS.
 template <class Algo, class Graph>
-void run(Algo &algo, const Graph &G, bool verify) {
-  using NodeId = typename Graph::NodeId;
-  for (int v = 0; v < NUM_SRC; v++) {
-    NodeId s = hash32(v) % G.n;
-    run(algo, G, verify, s);
+double run(Algo &algo, const Graph &G, bool verify, bool tree, NodeId source,
+           const sequence<NodeId> &rank) {
+  auto sources = get_sources(G, source);
+  double total_time = 0, inverse_teps = 0;
+  size_t num_traversals = 0;
+  for (NodeId s : sources) {
+    auto [time, teps] = run(algo, G, verify, tree, rank.empty() ? s : rank[s]);
+    total_time += time;
+    // sources without edges are left out, as Graph500 never samples them
+    if (teps > 0) {
+      inverse_teps += 1 / teps;
+      num_traversals++;
+    }
+  }
+  if (num_traversals) {
+    printf("Harmonic mean TEPS: %e\n", num_traversals / inverse_teps);
+  }
+  return total_time / sources.size();
+}
+
+// Times the point-to-point searches from s to t and returns the average time
+template <class Graph>
+double run_query(Bidirectional_BFS<Graph> &algo, const Graph &G, bool verify,
+                 NodeId s, NodeId t) {
+  printf("source %-10zu target %-10zu\n", static_cast<size_t>(s),
+         static_cast<size_t>(t));
+  double total_time = 0;
+  NodeId d = 0;
+  for (int i = 0; i <= NUM_ROUND; i++) {
+    internal::timer tm;
+    d = algo.distance(s, t);
+    tm.stop();
+    if (i == 0) {
+      printf("Warmup Round: %f\n", tm.total_time());
+    } else {
+      printf("Round %d: %f\n", i, tm.total_time());
+      total_time += tm.total_time();
+    }
+  }
+  double average_time = total_time / NUM_ROUND;
+  printf("Average time: %f\n", average_time);
+  if (d == numeric_limits<NodeId>::max()) {
+    printf("Distance: unreachable\n");
+  } else {
+    printf("Distance: %zu\n", static_cast<size_t>(d));
+  }
+
+  ofstream ofs("bfs.tsv", ios_base::app);
+  ofs << s << '\t' << t << '\t' << average_time << '\n';
+  ofs.close();
+
+  if (verify) {
+    printf("Running verifier...\n");
+    Seq_BFS verifier(G);
+    assert(d == verifier.bfs(s)[t]);
+    auto path = algo.path(s, t);
+    if (d == numeric_limits<NodeId>::max()) {
+      assert(path.empty());
+    } else {
+      assert(path.size() == d + 1 && path[0] == s && path[d] == t);
+      for (size_t i = 0; i < d; i++) {
+        bool found = false;
+        G.map_neighbors_until(path[i], [&](NodeId v, auto) {
+          found = v == path[i + 1];
+          return found;
+        });
+        assert(found);
+      }
+    }
+    printf("Passed!\n");
+  }
+  printf("\n");
+  return average_time;
+}
+
+// Runs the searches from source, or from NUM_SRC random sources if source is
+// NO_SOURCE, to target
+template <class Graph>
+double run_queries(Bidirectional_BFS<Graph> &algo, const Graph &G, bool verify,
+                   NodeId source, NodeId target, const sequence<NodeId> &rank) {
+  auto sources = get_sources(G, source);
+  double total_time = 0;
+  for (NodeId s : sources) {
+    total_time += run_query(algo, G, verify, rank.empty() ? s : rank[s],
+                            rank.empty() ? target : rank[target]);
+  }
+  return total_time / sources.size();
+}
+
+// Times the search for the vertices within hops of the sources, which are the
+// seeds of one search, and returns the average time
+template <class Graph>
+double run_khop(BFS<Graph> &algo, const Graph &G, bool verify, NodeId source,
+                NodeId hops, const sequence<NodeId> &rank) {
+  auto seeds = get_sources(G, source);
+  if (!rank.empty()) {
+    seeds = parlay::map(seeds, [&](NodeId s) { return rank[s]; });
+  }
+  printf("%zu seeds, %zu hops\n", seeds.size(), static_cast<size_t>(hops));
+  double total_time = 0;
+  sequence<pair<NodeId, NodeId>> reached;
+  for (int i = 0; i <= NUM_ROUND; i++) {
+    internal::timer t;
+    reached = algo.khop(seeds, hops);
+    t.stop();
+    if (i == 0) {
+      printf("Warmup Round: %f\n", t.total_time());
+    } else {
+      printf("Round %d: %f\n", i, t.total_time());
+      total_time += t.total_time();
+    }
+  }
+  double average_time = total_time / NUM_ROUND;
+  printf("Average time: %f\n", average_time);
+  printf("Reached vertices: %zu\n", reached.size());
+
+  if (verify) {
+    printf("Running verifier...\n");
+    Seq_BFS verifier(G);
+    sequence<NodeId> exp_dist(G.n, numeric_limits<NodeId>::max());
+    for (NodeId s : seeds) {
+      auto dist = verifier.bfs(s);
+      parallel_for(0, G.n,
+                   [&](size_t v) { exp_dist[v] = min(exp_dist[v], dist[v]); });
+    }
+    auto exp_reached =
+        count_if(exp_dist, [&](NodeId d) { return d <= hops; });
+    assert(reached.size() == exp_reached);
+    for (auto [v, d] : reached) {
+      assert(exp_dist[v] == d);
+    }
+    printf("Passed!\n");
+  }
+  printf("\n");
+  return average_time;
+}
+
+// With a target, times point-to-point searches with Bidirectional_BFS instead,
+// and with hops, k-hop searches. A nonzero budget limits the BFS workspace to
+// that many bytes. Sparse rounds prefetch prefetch_distance vertices ahead.
+template <class Graph>
+double run(Graph &G, bool compressed, bool verify, bool tree, NodeId source,
+           NodeId target, NodeId hops, size_t budget,
+           size_t prefetch_distance, const sequence<NodeId> &rank) {
+  auto run_on = [&](const auto &H) {
+    if (target != NO_SOURCE) {
+      Bidirectional_BFS solver(H);
+      return run_queries(solver, H, verify, source, target, rank);
+    }
+    BFS solver(H, budget);
+    solver.set_prefetch_distance(prefetch_distance);
+    double average_time =
+        hops != NO_SOURCE
+            ? run_khop(solver, H, verify, source, hops, rank)
+            : run(solver, H, verify, tree, source, rank);
+    printf("Peak BFS workspace: %zu bytes\n", solver.peak_memory());
+    return average_time;
+  };
+  if (compressed) {
+    printf("Compressing graph...\n");
+    internal::timer t;
+    CompressedGraph CG(G);
+    t.stop();
+    size_t original_size = G.offsets.size() * sizeof(G.offsets[0]) +
+                           G.edges.size() * sizeof(G.edges[0]) +
+                           G.in_offsets.size() * sizeof(G.in_offsets[0]) +
+                           G.in_edges.size() * sizeof(G.in_edges[0]);
+    printf("Compressed %zu bytes to %zu bytes in %f seconds\n", original_size,
+           CG.size_in_bytes(), t.total_time());
+    G = Graph();
+    return run_on(CG);
+  } else {
+    return run_on(G);
   }
 }
 
 int main(int argc, char *argv[]) {
   if (argc == 1) {
     fprintf(stderr,
-            "Usage: %s [-i input_file] [-s] [-v]\n"
+            "Usage: %s [-i input_file] [-s] [-v] [-t] [-c] [-o ordering] "
+            "[-r source] [-q target] [-k hops] [-m budget] [-f distance]\n"
             "Options:\n"
             "\t-i,\tinput file path\n"
             "\t-s,\tsymmetrized input graph\n"
-            "\t-v,\tverify result\n",
-            argv[0]);
+            "\t-v,\tverify result\n"
+            "\t-t,\talso compute BFS parents, and validate them with -v\n"
+            "\t-c,\trun on the compressed graph\n"
+            "\t-o,\talso run after reordering vertices: [degree] [hub] "
+            "[bfs] [rcm] [gorder] [ldd]\n"
+            "\t-r,\tsource vertex (default: 5 random sources)\n"
+            "\t-q,\ttime bidirectional searches from the sources to target\n"
+            "\t-k,\ttime the search for the vertices within hops of the "
+            "sources\n"
+            "\t-m,\tlimit the BFS workspace to budget MB, growing it with "
+            "the frontier\n"
+            "\t-f,\tprefetch distance of sparse rounds, 0 to disable "
+            "(default: %zu)\n",
+            argv[0], PREFETCH_DISTANCE);
     exit(EXIT_FAILURE);
   }
   char c;
   char const *input_path = nullptr;
   bool symmetrized = false;
   bool verify = false;
-  uint32_t source = UINT_MAX;
-  while ((c = getopt(argc, argv, "i:svr:")) != -1) {
+  bool tree = false;
+  bool compressed = false;
+  char const *ordering = nullptr;
+  NodeId source = NO_SOURCE;
+  NodeId target = NO_SOURCE;
+  NodeId hops = NO_SOURCE;
+  size_t budget = 0;
+  size_t prefetch_distance = PREFETCH_DISTANCE;
+  while ((c = getopt(argc, argv, "i:svtco:r:q:k:m:f:")) != -1) {
     switch (c) {
       case 'i':
         input_path = optarg;
@@ -77,27 +316,67 @@ int main(int argc, char *argv[]) {
       case 'v':
         verify = true;
         break;
+      case 't':
+        tree = true;
+        break;
+      case 'c':
+        compressed = true;
+        break;
+      case 'o':
+        ordering = optarg;
+        break;
       case 'r':
         source = atol(optarg);
+        break;
+      case 'q':
+        target = atol(optarg);
+        break;
+      case 'k':
+        hops = atol(optarg);
+        break;
+      case 'm':
+        budget = atof(optarg) * (1 << 20);
+        break;
+      case 'f':
+        prefetch_distance = atol(optarg);
+        break;
     }
   }
 
   printf("Reading graph...\n");
-  Graph G;
+  Graph<NodeId, EdgeId> G;
   G.read_graph(input_path);
   G.symmetrized = symmetrized;
   if (!G.symmetrized) {
-    G.make_inverse();
+    G.make_inverse(input_path);
   }
 
   fprintf(stdout, "Running on %s: |V|=%zu, |E|=%zu, num_src=%d, num_round=%d\n",
           input_path, G.n, G.m, NUM_SRC, NUM_ROUND);
 
-  BFS solver(G);
-  if (source == UINT_MAX) {
-    run(solver, G, verify);
-  } else {
-    run(solver, G, verify, source);
+  sequence<NodeId> rank;
+  decltype(G) RG;
+  if (ordering) {
+    printf("Reordering graph (%s)...\n", ordering);
+    internal::timer t;
+    rank = reorder(G, parse_ordering(ordering));
+    RG = relabel(G, rank);
+    if (!RG.symmetrized) {
+      RG.make_inverse();
+    }
+    t.stop();
+    printf("Reordering time: %f\n", t.total_time());
+  }
+
+  double average_time =
+      run(G, compressed, verify, tree, source, target, hops, budget,
+          prefetch_distance, {});
+  if (ordering) {
+    printf("Running on the reordered graph...\n");
+    double reordered_time = run(RG, compressed, verify, tree, source, target,
+                                hops, budget, prefetch_distance, rank);
+    printf("Average time before reordering: %f, after reordering (%s): %f\n",
+           average_time, ordering, reordered_time);
   }
   return 0;
 }
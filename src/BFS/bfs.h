@@ -1,10 +1,15 @@
 #pragma once
 #include <climits>
+#include <tuple>
 
+#include "bitmap.h"
 #include "graph.h"
 #include "hashbag.h"
+#include "neighbor_scan.h"
+#include "parlay/primitives.h"
 #include "parlay/sequence.h"
 #include "parlay/slice.h"
+#include "prefetch.h"
 #include "utils.h"
 
 using namespace std;
@@ -21,6 +26,7 @@ class BFS {
   static constexpr size_t NUM_SAMPLES = 1024;
   static constexpr size_t SPARSE_TH = 20;
   static constexpr size_t GROWTH_FACTOR = 10;
+  static constexpr size_t RESET_TH = 20;
 
   const Graph &G;
   const int LOG2N;
@@ -29,27 +35,172 @@ class BFS {
   sequence<hashbag<NodeId>> bags;
   sequence<NodeId> frontier;
   sequence<NodeId> dist;
-  sequence<int> bag_id;
-  sequence<atomic<bool>> in_frontier;
+  sequence<NodeId> parent;
+  sequence<uint8_t> bag_id;
+  bitmap in_frontier;
+  // vertices whose distance is final, found by dense rounds. Dense rounds
+  // skip them, and words of 64 of them at once.
+  bitmap settled;
+  // the vertices reached by the last search are visited[0, num_visited). They
+  // are collected in touched while searching, but only once a caller needs
+  // them (see track_visited). Until then searches set num_visited to n, so
+  // that the next search resets the whole graph.
+  bool tracking;
+  hashbag<NodeId> touched;
+  sequence<NodeId> visited;
+  size_t num_visited;
   bool sparse;
   bool use_local_queue;
+  bool record_parents;
+  // vertices at this distance are not expanded
+  NodeId max_hops;
+  // With a budget, the hashbags, frontier and visited start small and grow
+  // with the search as long as the workspace stays within budget bytes
+  size_t budget;
+  size_t peak_bytes;
+  bool force_dense;
+  // sparse rounds prefetch the neighbors of the frontier this many vertices
+  // ahead (see prefetch.h)
+  size_t prefetch_distance;
 
  public:
   BFS() = delete;
-  BFS(const Graph &_G)
-      : G(_G), LOG2N(log2_up(G.n)), num_bags(log2_up(LOCAL_QUEUE_SIZE) + 2) {
-    bags = sequence<hashbag<NodeId>>(num_bags, hashbag<NodeId>(G.n));
-    frontier = sequence<NodeId>::uninitialized(G.n);
-    dist = sequence<NodeId>::uninitialized(G.n);
-    bag_id = sequence<int>::uninitialized(G.n);
-    in_frontier = sequence<atomic<bool>>(G.n);
+  // A budget of 0 allocates the whole workspace up front
+  BFS(const Graph &_G, size_t _budget = 0)
+      : G(_G),
+        LOG2N(log2_up(G.n)),
+        num_bags(log2_up(LOCAL_QUEUE_SIZE) + 2),
+        tracking(false),
+        touched(G.n, 0.5, DIST_MAX, 0),
+        budget(_budget) {
+    bags = sequence<hashbag<NodeId>>(
+        num_bags,
+        hashbag<NodeId>(G.n, 0.5, DIST_MAX,
+                        budget ? 0 : numeric_limits<size_t>::max()));
+    if (!budget) {
+      frontier = sequence<NodeId>::uninitialized(G.n);
+    }
+    dist = sequence<NodeId>(G.n, DIST_MAX);
+    bag_id = sequence<uint8_t>(G.n, LOG2N);
+    in_frontier = bitmap(G.n);
+    settled = bitmap(G.n);
+    num_visited = 0;
+    record_parents = false;
+    max_hops = DIST_MAX;
+    force_dense = false;
+    prefetch_distance = PREFETCH_DISTANCE;
+    peak_bytes = 0;
+    update_peak();
+    if (budget && peak_bytes > budget) {
+      std::cerr << "Error: BFS needs a workspace of at least " << peak_bytes
+                << " bytes" << std::endl;
+      abort();
+    }
+  }
+
+  // Largest workspace of the solver so far, in bytes
+  size_t peak_memory() const { return peak_bytes; }
+
+  // 0 turns the prefetching of sparse rounds off
+  void set_prefetch_distance(size_t d) { prefetch_distance = d; }
+
+  // Lowers dist[v] to dist[u] + 1, and records v as reached if it was not
+  bool relax(NodeId u, NodeId v) {
+    NodeId d = dist[u] + 1;
+    NodeId old = fetch_and_min(&dist[v], d);
+    if (d >= old) {
+      return false;
+    }
+    if (old == DIST_MAX && tracking) {
+      touched.insert(v);
+    }
+    return true;
+  }
+
+  // Collects the visited vertices from the next search on. A budget lets
+  // touched grow with the searches instead.
+  void track_visited() {
+    if (tracking) {
+      return;
+    }
+    tracking = true;
+    if (!budget) {
+      touched.reserve(G.n);
+      visited = sequence<NodeId>::uninitialized(G.n);
+      update_peak();
+    }
+  }
+
+  size_t workspace_bytes() const {
+    size_t bytes = (dist.size() + parent.size() + frontier.size() +
+                    visited.size()) *
+                       sizeof(NodeId) +
+                   bag_id.size() * sizeof(bag_id[0]) +
+                   in_frontier.size_in_bytes() + settled.size_in_bytes() +
+                   touched.size_in_bytes();
+    for (size_t i = 0; i < num_bags; i++) {
+      bytes += bags[i].size_in_bytes();
+    }
+    return bytes;
+  }
+
+  // extra bytes are about to be allocated
+  void update_peak(size_t extra = 0) {
+    peak_bytes = max(peak_bytes, workspace_bytes() + extra);
+  }
+
+  // Makes room for k vertices in bag unless that exceeds the budget
+  bool try_reserve(hashbag<NodeId> &bag, size_t k) {
+    size_t bytes = bag.capacity_for(k) * sizeof(NodeId);
+    if (bytes <= bag.size_in_bytes()) {
+      return true;
+    }
+    if (workspace_bytes() + bytes > budget) {
+      return false;
+    }
+    update_peak(bytes);
+    bag.reserve(k);
+    return true;
+  }
+
+  // After some bags dropped vertices. The vertices waiting in the bags are
+  // those in in_frontier, so the bags that overflowed grow to hold all of them,
+  // and at least double, and are refilled. Returns false if that exceeds the
+  // budget.
+  bool regrow_bags() {
+    while (true) {
+      bool overflowed = false;
+      size_t k = in_frontier.count();
+      for (size_t i = 0; i < num_bags; i++) {
+        if (bags[i].overflowed()) {
+          overflowed = true;
+          size_t slots = bags[i].size_in_bytes() / sizeof(NodeId);
+          if (!try_reserve(bags[i], max(k, slots))) {
+            return false;
+          }
+        }
+      }
+      if (!overflowed) {
+        return true;
+      }
+      dense2sparse();
+    }
+  }
+
+  // Moves bag b to the frontier and returns its size
+  size_t pack_frontier(size_t b) {
+    if (budget) {
+      update_peak(bags[b].size_in_bytes());
+      frontier = bags[b].pack();
+      return frontier.size();
+    }
+    return bags[b].pack_into(make_slice(frontier));
   }
 
   void add_to_frontier(NodeId v) {
     if (sparse) {
-      int id = dist[v] == 0 ? 0 : log2_up(dist[v]);
-      if (in_frontier[v] == false) {
-        in_frontier[v] = true;
+      uint8_t id = dist[v] == 0 ? 0 : log2_up(dist[v]);
+      if (!in_frontier.test_and_set(v)) {
         write_min(&bag_id[v], id);
         bags[id % num_bags].insert(v);
       } else {
@@ -58,7 +209,7 @@ class BFS {
         }
       }
     } else {
-      in_frontier[v] = true;
+      in_frontier.set(v);
     }
   }
 
@@ -76,84 +227,118 @@ class BFS {
   }
 
   void visit_neighbors_parallel(NodeId u) {
-    parallel_for(
-        G.offsets[u], G.offsets[u + 1],
-        [&](size_t i) {
-          NodeId v = G.edges[i].v;
-          if (write_min(&dist[v], dist[u] + 1)) {
+    if (dist[u] >= max_hops) {
+      return;
+    }
+    G.map_neighbors_parallel(
+        u,
+        [&](NodeId v, auto) {
+          if (relax(u, v)) {
+            if (record_parents) {
+              parent[v] = u;
+            }
             add_to_frontier(v);
           }
         },
         BLOCK_SIZE);
   }
 
+  // The local queue runs ahead of the round, but stops at max_hops like the
+  // frontier
   void visit_neighbors_sequential(NodeId u, NodeId *local_queue, size_t &rear) {
-    for (EdgeId i = G.offsets[u]; i < G.offsets[u + 1]; i++) {
-      NodeId v = G.edges[i].v;
-      if (write_min(&dist[v], dist[u] + 1)) {
+    if (dist[u] >= max_hops) {
+      return;
+    }
+    G.map_neighbors(u, [&](NodeId v, auto) {
+      if (relax(u, v)) {
+        if (record_parents) {
+          parent[v] = u;
+        }
         if (rear < LOCAL_QUEUE_SIZE) {
           local_queue[rear++] = v;
         } else {
           add_to_frontier(v);
         }
       }
-    }
+    });
   }
 
   void dense2sparse() {
     for (size_t i = 0; i < num_bags; i++) {
       bags[i].clear();
     }
-    parallel_for(0, G.n, [&](size_t i) {
-      if (in_frontier[i]) {
-        size_t id = log2_up(dist[i]);
-        bags[id % num_bags].insert(i);
-      }
+    in_frontier.for_each([&](NodeId i) {
+      size_t id = log2_up(dist[i]);
+      bags[id % num_bags].insert(i);
     });
   }
 
   void sparse_relax(size_t id, size_t frontier_size) {
-    parallel_for(0, frontier_size, [&](size_t i) {
-      NodeId f = frontier[i];
-      in_frontier[f] = false;
-      if (id == 0 || id == log2_up(dist[f])) {
-        if (use_local_queue) {
-          NodeId local_queue[LOCAL_QUEUE_SIZE];
-          size_t front = 0, rear = 0;
-          local_queue[rear++] = f;
-          while (front < rear) {
-            NodeId u = local_queue[front++];
-            size_t deg = G.offsets[u + 1] - G.offsets[u];
-            if (deg < BLOCK_SIZE) {
-              visit_neighbors_sequential(u, local_queue, rear);
+    for_each_prefetched(
+        G, frontier, frontier_size, dist.data(), prefetch_distance,
+        [&](NodeId f) {
+          in_frontier.reset(f);
+          if (id == 0 || id == log2_up(dist[f])) {
+            if (use_local_queue) {
+              NodeId local_queue[LOCAL_QUEUE_SIZE];
+              size_t front = 0, rear = 0;
+              local_queue[rear++] = f;
+              while (front < rear) {
+                NodeId u = local_queue[front++];
+                size_t deg = G.degree(u);
+                if (deg < BLOCK_SIZE) {
+                  visit_neighbors_sequential(u, local_queue, rear);
+                } else {
+                  visit_neighbors_parallel(u);
+                }
+              }
             } else {
-              visit_neighbors_parallel(u);
+              visit_neighbors_parallel(f);
             }
           }
-        } else {
-          visit_neighbors_parallel(f);
-        }
-      }
-    });
+        });
   }
 
+  // Every word of in_frontier is updated by one thread, 64 vertices at a time.
+  // The in-neighbors that improve dist[u] are found with the vectorized scan
+  // of neighbor_scan.h. A vertex u with dist[u] <= round + 1 cannot improve,
+  // so it is settled, and later rounds only drop it from the frontier.
   void dense_relax([[maybe_unused]] size_t id) {
-    parallel_for(0, G.n, [&](NodeId u) {
-      if (dist[u] > round + 1) {
-        const auto neighbors = G.in_neighors(u);
-        for (size_t j = 0; j < neighbors.size(); j++) {
-          NodeId v = neighbors[j].v;
-          if (dist[v] != DIST_MAX && dist[u] > dist[v] + 1) {
-            dist[u] = dist[v] + 1;
-            in_frontier[u].store(true, std::memory_order_relaxed);
-            if (dist[v] == round) {
-              break;
-            }
+    parallel_for(0, in_frontier.num_words(), [&](size_t w) {
+      uint64_t done = settled.word(w);
+      uint64_t bits = in_frontier.word(w) & ~done;
+      uint64_t unsettled = ~done & settled.word_mask(w);
+      while (unsettled) {
+        uint64_t bit = unsettled & -unsettled;
+        NodeId u = w * bitmap::WORD_BITS + __builtin_ctzll(unsettled);
+        unsettled &= unsettled - 1;
+        if (dist[u] > round + 1) {
+          if (unsettled) {
+            prefetch_in_neighbors(
+                G, w * bitmap::WORD_BITS + __builtin_ctzll(unsettled));
           }
+          scan_in_neighbors_below(
+              G, u, dist, [&]() { return min(max_hops, dist[u] - 1); },
+              [&](NodeId v) {
+                if (dist[u] == DIST_MAX && tracking) {
+                  touched.insert(u);
+                }
+                dist[u] = dist[v] + 1;
+                if (record_parents) {
+                  parent[u] = v;
+                }
+                bits |= bit;
+                return dist[v] == round;
+              });
+        } else if (dist[u] <= round) {
+          bits &= ~bit;
+        }
+        if (dist[u] <= round + 1) {
+          done |= bit;
         }
-      } else if (dist[u] <= round) {
-        in_frontier[u].store(false, std::memory_order_relaxed);
       }
+      settled.word(w) = done;
+      in_frontier.word(w) = bits;
     });
   }
 
@@ -161,16 +346,126 @@ class BFS {
     return frontier_size * SPARSE_TH < G.n;
   }
 
+  // Parents are written after the distance they were found with, so a
+  // vertex whose distance was lowered concurrently by two relaxations may keep
+  // the parent of the larger one. Such vertices pick a parent on the previous
+  // level among their in-neighbors.
+  void repair_parents(NodeId s) {
+    parallel_for(0, num_visited, [&](size_t i) {
+      NodeId v = visited[i];
+      if (v == s) {
+        return;
+      }
+      NodeId p = parent[v];
+      if (p == DIST_MAX || dist[p] + 1 != dist[v]) {
+        G.map_in_neighbors_until(v, [&](NodeId u, auto) {
+          if (dist[u] + 1 == dist[v]) {
+            parent[v] = u;
+            return true;
+          }
+          return false;
+        });
+      }
+    });
+  }
+
+  // Distances and BFS parents from s. The parent of s is s, and the parent of
+  // an unreachable vertex is DIST_MAX.
+  tuple<sequence<NodeId>, sequence<NodeId>> bfs_tree(NodeId s) {
+    if (parent.size() != G.n) {
+      if (budget && workspace_bytes() + G.n * sizeof(NodeId) > budget) {
+        std::cerr << "Error: BFS parents exceed the workspace budget"
+                  << std::endl;
+        abort();
+      }
+      parent = sequence<NodeId>(G.n, DIST_MAX);
+      update_peak();
+    }
+    track_visited();
+    record_parents = true;
+    search(&s, 1);
+    repair_parents(s);
+    record_parents = false;
+    return {dist, parent};
+  }
+
   sequence<NodeId> bfs(NodeId s) {
-    parallel_for(0, G.n, [&](size_t i) {
-      in_frontier[i] = false;
-      dist[i] = DIST_MAX;
-      bag_id[i] = LOG2N;
+    record_parents = false;
+    search(&s, 1);
+    return dist;
+  }
+
+  // Searches from s like bfs, but leaves the distances in the solver instead
+  // of copying them out. Returns the reached vertices, whose distances are
+  // given by distance(v) until the next search. As the next search resets
+  // only these vertices, a search that reaches a small part of the graph
+  // costs time proportional to that part.
+  auto bfs_reached(NodeId s) {
+    track_visited();
+    record_parents = false;
+    search(&s, 1);
+    return visited.cut(0, num_visited);
+  }
+
+  NodeId distance(NodeId v) const { return dist[v]; }
+
+  // The vertices within k hops of some seed, with their distances to the
+  // nearest seed. Vertices k hops away are not expanded, so the search only
+  // scans the edges of the vertices less than k hops away.
+  sequence<pair<NodeId, NodeId>> khop(const sequence<NodeId> &seeds,
+                                      NodeId k) {
+    track_visited();
+    record_parents = false;
+    max_hops = k;
+    search(seeds.data(), seeds.size());
+    max_hops = DIST_MAX;
+    return tabulate(num_visited, [&](size_t i) {
+      return make_pair(visited[i], dist[visited[i]]);
     });
+  }
+
+ private:
+  // Undoes the last search, touching only the vertices it reached unless
+  // they are a large part of the graph
+  void reset() {
+    auto clear = [&](NodeId v) {
+      dist[v] = DIST_MAX;
+      bag_id[v] = LOG2N;
+      if (parent.size() == G.n) {
+        parent[v] = DIST_MAX;
+      }
+    };
+    if (num_visited * RESET_TH >= G.n) {
+      parallel_for(0, G.n, [&](size_t i) { clear(i); });
+      in_frontier.clear();
+      settled.clear();
+    } else {
+      parallel_for(0, num_visited, [&](size_t i) {
+        clear(visited[i]);
+        in_frontier.reset(visited[i]);
+        settled.reset(visited[i]);
+      });
+    }
+    num_visited = 0;
+  }
 
+  // Searches from sources[0, k) at once
+  void search(const NodeId *sources, size_t k) {
+    reset();
     sparse = true;
-    dist[s] = 0;
-    add_to_frontier(s);
+    for (size_t i = 0; i < k; i++) {
+      NodeId s = sources[i];
+      if (dist[s] != 0) {
+        dist[s] = 0;
+        if (tracking) {
+          touched.insert(s);
+        }
+        if (record_parents) {
+          parent[s] = s;
+        }
+        add_to_frontier(s);
+      }
+    }
 
     round = 0;
     size_t prev_size = 0;
@@ -183,12 +478,15 @@ class BFS {
         size_t approx_size = estimate_size(i);
         // internal::timer t;
         // printf("prev_size: %zu, approx_size: %zu\n", prev_size, approx_size);
-        if (if_sparse(approx_size)) {
+        if (!force_dense && if_sparse(approx_size)) {
           if (dense) {
             dense2sparse();
+            if (budget && !regrow_bags()) {
+              force_dense = true;
+              continue;
+            }
           }
-          size_t frontier_size =
-              bags[i % num_bags].pack_into(make_slice(frontier));
+          size_t frontier_size = pack_frontier(i % num_bags);
           if (frontier_size <= prev_size * GROWTH_FACTOR) {
             use_local_queue = true;
           } else {
@@ -203,11 +501,16 @@ class BFS {
           sparse_relax(i, frontier_size);
           dense = false;
           round++;
+          if (budget && !regrow_bags()) {
+            // the next rounds find the frontier in in_frontier
+            dense = force_dense = true;
+          }
           // t.next("sparse");
         } else {
           // printf("Round %zu: ", round);
           dense_relax(i);
           dense = true;
+          force_dense = false;
           round++;
           // t.next("dense");
           prev_size = approx_size;
@@ -216,8 +519,29 @@ class BFS {
     }
 
     for (size_t i = 0; i < num_bags; i++) {
-      assert(bags[i].pack_into(make_slice(frontier)) == 0);
+      assert(bags[i].pack().empty());
     }
-    return dist;
+    if (!tracking) {
+      num_visited = G.n;
+    } else if (!budget) {
+      num_visited = touched.pack_into(make_slice(visited));
+    } else {
+      visited = sequence<NodeId>();
+      if (touched.overflowed()) {
+        // make room for as many vertices in the next search
+        visited = pack_index<NodeId>(delayed_seq<bool>(
+            G.n, [&](size_t v) { return dist[v] != DIST_MAX; }));
+        touched.clear();
+        try_reserve(touched, visited.size());
+      } else {
+        update_peak(touched.size_in_bytes());
+        visited = touched.pack();
+      }
+      num_visited = visited.size();
+    }
+    if (budget) {
+      frontier = sequence<NodeId>();
+    }
+    update_peak();
   }
 };
@@ -2,8 +2,10 @@
 
 #include <queue>
 
+#include "bidirectional-bfs.h"
 #include "connectivity.h"
 #include "graph.h"
+#include "multi-bfs.h"
 #include "seq-bfs.h"
 
 constexpr int NUM_SRC = 10;
@@ -34,8 +36,9 @@ void run(Func &&f) {
 template <class Graph, class NodeId = typename Graph::NodeId>
 void run(const Graph &G, const sequence<NodeId> &largest_cc) {
   size_t m = largest_cc.size();
-  for (int v = 0; v < NUM_SRC; v++) {
-    NodeId s = largest_cc[hash32(v) % m];
+  auto sources = tabulate(
+      NUM_SRC, [&](size_t v) -> NodeId { return largest_cc[hash32(v) % m]; });
+  for (NodeId s : sources) {
     sequence<NodeId> dist1, dist2;
 
     {
@@ -53,6 +56,37 @@ void run(const Graph &G, const sequence<NodeId> &largest_cc) {
     ofs << s << '\n';
     printf("\n");
   }
+
+  // All sources in one multi-source BFS
+  printf("Multi-source BFS from %d sources\n", NUM_SRC);
+  sequence<sequence<NodeId>> dists;
+  {
+    Multi_BFS solver(G);
+    run([&]() { dists = solver.bfs(sources); });
+  }
+  Seq_BFS verifier(G);
+  for (int i = 0; i < NUM_SRC; i++) {
+    assert(dists[i] == verifier.bfs(sources[i]));
+  }
+  ofstream ofs("bfs.tsv", ios_base::app);
+  ofs << "multi" << '\n';
+  printf("\n");
+
+  // Point-to-point searches between consecutive sources
+  printf("Bidirectional BFS between %d pairs of sources\n", NUM_SRC);
+  Bidirectional_BFS pair_solver(G);
+  sequence<NodeId> pair_dist(NUM_SRC);
+  run([&]() {
+    for (int i = 0; i < NUM_SRC; i++) {
+      pair_dist[i] = pair_solver.distance(sources[i],
+                                          sources[(i + 1) % NUM_SRC]);
+    }
+  });
+  for (int i = 0; i < NUM_SRC; i++) {
+    assert(pair_dist[i] == dists[i][sources[(i + 1) % NUM_SRC]]);
+  }
+  ofs << "bidirectional" << '\n';
+  printf("\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -84,7 +118,7 @@ int main(int argc, char *argv[]) {
   G.read_graph(input_path);
   G.symmetrized = symmetrized;
   if (!G.symmetrized) {
-    G.make_inverse();
+    G.make_inverse(input_path);
   }
 
   fprintf(stdout, "Running on %s: |V|=%zu, |E|=%zu, num_src=%d, num_round=%d\n",
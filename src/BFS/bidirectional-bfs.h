@@ -0,0 +1,179 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+
+#include "graph.h"
+#include "hashbag.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "parlay/slice.h"
+#include "utils.h"
+
+using namespace std;
+using namespace parlay;
+
+// Point-to-point BFS that grows a forward frontier from s along out-edges and
+// a backward frontier from t along in-edges, one level at a time on the side
+// whose frontier has fewer edges to scan. The search stops after the first
+// level in which the two sides meet. Directed graphs need their in-CSR.
+//
+// Every side keeps the vertices it has visited, level by level, so that the
+// frontier is the last level and a query resets only the vertices it touched.
+// New levels are collected in a hashbag as in BFS, and the edges of
+// high-degree vertices are scanned in parallel.
+template <class Graph>
+class Bidirectional_BFS {
+ public:
+  using NodeId = typename Graph::NodeId;
+
+  static constexpr NodeId DIST_MAX = numeric_limits<NodeId>::max();
+
+ private:
+  static constexpr size_t BLOCK_SIZE = 1024;
+  static constexpr int FORWARD = 0;
+  static constexpr int BACKWARD = 1;
+
+  const Graph &G;
+  hashbag<NodeId> bag;
+  // dist[side][v] is the distance from s (forward) or to t (backward), and
+  // parent[side][v] the next vertex on the way back to s or t
+  sequence<NodeId> dist[2];
+  sequence<NodeId> parent[2];
+  // visited[side][0, size[side]) in order of distance, where the frontier
+  // starts at frontier_start[side]
+  sequence<NodeId> visited[2];
+  size_t size[2];
+  size_t frontier_start[2];
+  NodeId level[2];
+  // a meeting edge meet_from -> meet_to, where meet_from is reached from s
+  // and meet_to reaches t
+  NodeId meet_from, meet_to;
+  bool met;
+
+  size_t frontier_edges(int side) const {
+    auto frontier = visited[side].cut(frontier_start[side], size[side]);
+    return reduce(delayed_seq<size_t>(frontier.size(), [&](size_t i) {
+      return side == FORWARD ? G.degree(frontier[i])
+                             : G.in_degree(frontier[i]);
+    }));
+  }
+
+  // Scans the edges of the frontier of side, and makes the unvisited
+  // endpoints the next level
+  void expand(int side) {
+    int other = 1 - side;
+    NodeId d = level[side];
+    auto frontier = visited[side].cut(frontier_start[side], size[side]);
+    parallel_for(
+        0, frontier.size(),
+        [&](size_t i) {
+          NodeId u = frontier[i];
+          auto relax = [&](NodeId v, auto) {
+            if (dist[other][v] != DIST_MAX && !met &&
+                compare_and_swap(&met, false, true)) {
+              meet_from = side == FORWARD ? u : v;
+              meet_to = side == FORWARD ? v : u;
+            }
+            if (dist[side][v] == DIST_MAX &&
+                compare_and_swap(&dist[side][v], DIST_MAX, d + 1)) {
+              parent[side][v] = u;
+              bag.insert(v);
+            }
+            return false;
+          };
+          if (side == FORWARD) {
+            if (G.degree(u) < BLOCK_SIZE) {
+              G.map_neighbors_until(u, relax);
+            } else {
+              G.map_neighbors_parallel(u, relax, BLOCK_SIZE);
+            }
+          } else {
+            if (G.in_degree(u) < BLOCK_SIZE) {
+              G.map_in_neighbors_until(u, relax);
+            } else {
+              G.map_in_neighbors_parallel(u, relax, BLOCK_SIZE);
+            }
+          }
+        },
+        1);
+    frontier_start[side] = size[side];
+    size[side] += bag.pack_into(visited[side].cut(size[side], G.n));
+    level[side]++;
+  }
+
+  // Returns the distance from s to t and leaves the meeting edge in meet_from
+  // and meet_to. When the sides first meet while expanding the forward side
+  // from level df, no vertex was visited by both, so every path from s to t
+  // is longer than df + db, where db is the level of the backward side. A
+  // shortest path of length df + db + 1 leaves the forward frontier to a
+  // vertex visited by the backward side, which is found in this round, and
+  // every meeting edge found gives a path of that length.
+  NodeId search(NodeId s, NodeId t) {
+    met = false;
+    NodeId ends[2] = {s, t};
+    for (int side : {FORWARD, BACKWARD}) {
+      dist[side][ends[side]] = 0;
+      parent[side][ends[side]] = ends[side];
+      visited[side][0] = ends[side];
+      size[side] = 1;
+      frontier_start[side] = 0;
+      level[side] = 0;
+    }
+    if (s == t) {
+      meet_from = meet_to = s;
+      return 0;
+    }
+    while (!met && frontier_start[FORWARD] < size[FORWARD] &&
+           frontier_start[BACKWARD] < size[BACKWARD]) {
+      expand(frontier_edges(FORWARD) <= frontier_edges(BACKWARD) ? FORWARD
+                                                                 : BACKWARD);
+    }
+    return met ? level[FORWARD] + level[BACKWARD] : DIST_MAX;
+  }
+
+  void reset() {
+    for (int side : {FORWARD, BACKWARD}) {
+      parallel_for(0, size[side], [&](size_t i) {
+        dist[side][visited[side][i]] = DIST_MAX;
+      });
+    }
+  }
+
+ public:
+  Bidirectional_BFS() = delete;
+  Bidirectional_BFS(const Graph &_G) : G(_G), bag(G.n) {
+    for (int side : {FORWARD, BACKWARD}) {
+      dist[side] = sequence<NodeId>(G.n, DIST_MAX);
+      parent[side] = sequence<NodeId>::uninitialized(G.n);
+      visited[side] = sequence<NodeId>::uninitialized(G.n);
+    }
+  }
+
+  // Distance from s to t, DIST_MAX if t is unreachable
+  NodeId distance(NodeId s, NodeId t) {
+    NodeId d = search(s, t);
+    reset();
+    return d;
+  }
+
+  // Vertices of a shortest path from s to t, empty if t is unreachable
+  sequence<NodeId> path(NodeId s, NodeId t) {
+    NodeId d = search(s, t);
+    sequence<NodeId> ret;
+    if (d != DIST_MAX) {
+      for (NodeId v = meet_from; v != s; v = parent[FORWARD][v]) {
+        ret.push_back(v);
+      }
+      ret.push_back(s);
+      std::reverse(ret.begin(), ret.end());
+      if (meet_to != meet_from) {
+        for (NodeId v = meet_to; v != t; v = parent[BACKWARD][v]) {
+          ret.push_back(v);
+        }
+        ret.push_back(t);
+      }
+    }
+    reset();
+    return ret;
+  }
+};
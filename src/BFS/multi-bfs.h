@@ -0,0 +1,236 @@
+#pragma once
+#include <array>
+#include <climits>
+
+#include "graph.h"
+#include "hashbag.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "parlay/slice.h"
+#include "utils.h"
+
+using namespace std;
+using namespace parlay;
+
+// Multi-source BFS that runs up to MAX_SOURCES = 64 * NUM_WORDS searches at
+// once and shares the edge traversal between them. Every vertex keeps bitsets
+// with one bit per source: the sources that have reached it (seen), that
+// reached it in the last round (visit), and that reach it in the current round
+// (next). A round is top-down over the frontier vertices while they have few
+// out-edges, and bottom-up over the unfinished vertices otherwise. The
+// out-edges of the frontier are estimated from a sample of it, as BFS
+// estimates the size of its frontier.
+template <class Graph, size_t NUM_WORDS = 1>
+class Multi_BFS {
+ public:
+  using NodeId = typename Graph::NodeId;
+  using Mask = array<uint64_t, NUM_WORDS>;
+
+  static constexpr size_t MAX_SOURCES = 64 * NUM_WORDS;
+  static constexpr NodeId DIST_MAX = numeric_limits<NodeId>::max();
+
+ private:
+  static constexpr size_t BLOCK_SIZE = 1024;
+  static constexpr size_t NUM_SAMPLES = 1024;
+  static constexpr size_t SPARSE_TH = 20;
+
+  const Graph &G;
+  hashbag<NodeId> bag;
+  sequence<NodeId> frontier;
+  size_t frontier_size;
+  Mask active;
+  sequence<Mask> seen;
+  sequence<Mask> visit;
+  sequence<Mask> next;
+  sequence<bool> in_next;
+
+  static bool any(const Mask &mask) {
+    for (size_t w = 0; w < NUM_WORDS; w++) {
+      if (mask[w]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void add_to_next(NodeId v) {
+    if (!in_next[v] && compare_and_swap(&in_next[v], false, true)) {
+      bag.insert(v);
+    }
+  }
+
+  // Pushes the visit masks of the frontier vertices to their out-neighbors
+  void sparse_relax() {
+    parallel_for(
+        0, frontier_size,
+        [&](size_t i) {
+          NodeId u = frontier[i];
+          auto relax = [&](NodeId v, auto) {
+            bool added = false;
+            for (size_t w = 0; w < NUM_WORDS; w++) {
+              uint64_t bits = visit[u][w] & ~seen[v][w];
+              if (bits && (next[v][w] & bits) != bits) {
+                __sync_fetch_and_or(&next[v][w], bits);
+                added = true;
+              }
+            }
+            if (added) {
+              add_to_next(v);
+            }
+          };
+          if (G.degree(u) < BLOCK_SIZE) {
+            G.map_neighbors(u, relax);
+          } else {
+            G.map_neighbors_parallel(u, relax, BLOCK_SIZE);
+          }
+        },
+        1);
+  }
+
+  // Pulls the visit masks of the in-neighbors of every vertex that some
+  // source has not reached yet, until all of those sources are found
+  void dense_relax() {
+    parallel_for(0, G.n, [&](NodeId v) {
+      Mask want;
+      for (size_t w = 0; w < NUM_WORDS; w++) {
+        want[w] = active[w] & ~seen[v][w];
+      }
+      if (!any(want)) {
+        return;
+      }
+      Mask found{};
+      G.map_in_neighbors_until(v, [&](NodeId u, auto) {
+        bool done = true;
+        for (size_t w = 0; w < NUM_WORDS; w++) {
+          found[w] |= visit[u][w] & want[w];
+          done &= found[w] == want[w];
+        }
+        return done;
+      });
+      next[v] = found;
+      in_next[v] = any(found);
+    });
+  }
+
+  // Whether the frontier and its out-edges are at least m / SPARSE_TH, with
+  // the out-edges of large frontiers estimated from NUM_SAMPLES of them
+  bool if_dense() {
+    size_t edges;
+    if (frontier_size <= NUM_SAMPLES) {
+      edges = reduce(delayed_seq<size_t>(frontier_size, [&](size_t i) {
+        return G.degree(frontier[i]);
+      }));
+    } else {
+      size_t sampled = 0;
+      for (size_t i = 0; i < NUM_SAMPLES; i++) {
+        sampled += G.degree(frontier[hash32(i) % frontier_size]);
+      }
+      edges = sampled * frontier_size / NUM_SAMPLES;
+    }
+    return (frontier_size + edges) * SPARSE_TH >= G.m;
+  }
+
+  // Makes the vertices reached in this round the new frontier
+  void advance(bool dense) {
+    parallel_for(0, frontier_size,
+                 [&](size_t i) { visit[frontier[i]] = Mask{}; });
+    if (dense) {
+      auto packed = pack_index<NodeId>(make_slice(in_next));
+      frontier_size = packed.size();
+      parallel_for(0, frontier_size,
+                   [&](size_t i) { frontier[i] = packed[i]; });
+    } else {
+      frontier_size = bag.pack_into(make_slice(frontier));
+    }
+    parallel_for(0, frontier_size, [&](size_t i) {
+      NodeId v = frontier[i];
+      for (size_t w = 0; w < NUM_WORDS; w++) {
+        seen[v][w] |= next[v][w];
+      }
+      visit[v] = next[v];
+      next[v] = Mask{};
+      in_next[v] = false;
+    });
+  }
+
+  // Calls f(i) on every source i in mask
+  template <class F>
+  static void for_each_source(const Mask &mask, F &&f) {
+    for (size_t w = 0; w < NUM_WORDS; w++) {
+      uint64_t bits = mask[w];
+      while (bits) {
+        f(w * 64 + __builtin_ctzll(bits));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  // Searches from at most MAX_SOURCES sources, where source i is bit i of the
+  // masks, and calls on_round(d, vertices) after each round with the vertices
+  // at distance d from some source. visit[v] gives those sources during the
+  // call.
+  template <class F>
+  void search(const sequence<NodeId> &sources, F &&on_round) {
+    size_t k = sources.size();
+    if (k > MAX_SOURCES) {
+      std::cerr << "Error: Multi_BFS supports at most " << MAX_SOURCES
+                << " sources" << std::endl;
+      abort();
+    }
+    parallel_for(0, G.n, [&](size_t i) {
+      seen[i] = visit[i] = next[i] = Mask{};
+      in_next[i] = false;
+    });
+    active = Mask{};
+    frontier_size = 0;
+    for (size_t i = 0; i < k; i++) {
+      NodeId s = sources[i];
+      uint64_t bit = uint64_t{1} << (i % 64);
+      active[i / 64] |= bit;
+      seen[s][i / 64] |= bit;
+      visit[s][i / 64] |= bit;
+      if (!in_next[s]) {
+        in_next[s] = true;
+        frontier[frontier_size++] = s;
+      }
+    }
+    for (size_t i = 0; i < frontier_size; i++) {
+      in_next[frontier[i]] = false;
+    }
+
+    for (size_t d = 0; frontier_size; d++) {
+      on_round(d, frontier.cut(0, frontier_size));
+      bool dense = if_dense();
+      if (dense) {
+        dense_relax();
+      } else {
+        sparse_relax();
+      }
+      advance(dense);
+    }
+  }
+
+ public:
+  Multi_BFS() = delete;
+  Multi_BFS(const Graph &_G) : G(_G), bag(G.n) {
+    frontier = sequence<NodeId>::uninitialized(G.n);
+    seen = sequence<Mask>(G.n);
+    visit = sequence<Mask>(G.n);
+    next = sequence<Mask>(G.n);
+    in_next = sequence<bool>(G.n, false);
+  }
+
+  // Distances from each source, DIST_MAX for unreachable vertices
+  sequence<sequence<NodeId>> bfs(const sequence<NodeId> &sources) {
+    auto dist = tabulate(sources.size(), [&](size_t) {
+      return sequence<NodeId>(G.n, DIST_MAX);
+    });
+    search(sources, [&](size_t d, auto vertices) {
+      parallel_for(0, vertices.size(), [&](size_t j) {
+        NodeId v = vertices[j];
+        for_each_source(visit[v], [&](size_t i) { dist[i][v] = d; });
+      });
+    });
+    return dist;
+  }
+};
@@ -29,13 +29,12 @@ class Seq_BFS {
     while (!q.empty()) {
       NodeId u = q.front();
       q.pop();
-      for (size_t i = G.offsets[u]; i < G.offsets[u + 1]; i++) {
-        NodeId v = G.edges[i].v;
+      G.map_neighbors(u, [&](NodeId v, auto) {
         if (dist[v] == DIST_MAX) {
           dist[v] = dist[u] + 1;
           q.push(v);
         }
-      }
+      });
     }
     return dist;
   }
@@ -2,8 +2,10 @@
 #include <climits>
 #include <queue>
 
+#include "bitmap.h"
 #include "graph.h"
 #include "hashbag.h"
+#include "neighbor_scan.h"
 #include "parlay/sequence.h"
 #include "parlay/slice.h"
 #include "utils.h"
@@ -25,7 +27,7 @@ class REACH {
 
   hashbag<NodeId> bag;
   sequence<NodeId> frontier;
-  sequence<bool> dense_frontier;
+  bitmap dense_frontier;
   NodeId n_frontier;
 
  public:
@@ -33,15 +35,15 @@ class REACH {
   REACH() = delete;
   REACH(size_t n) : bag(n) {
     frontier=sequence<NodeId>::uninitialized(n);
-    dense_frontier = sequence<bool>::uninitialized(n);
+    dense_frontier = bitmap(n);
   }
 
 
-  size_t sparse_visit(const Graph& G, sequence<bool>& vist) {
+  size_t sparse_visit(const Graph& G, bitmap& vist) {
     parallel_for(0, n_frontier,[&](size_t i) {
         NodeId f = frontier[i];
         size_t f_visit = 0;
-        size_t deg_f = G.offsets[f + 1] - G.offsets[f];
+        size_t deg_f = G.degree(f);
         if ((deg_f < LOCAL_QUEUE_SIZE) && (deg_f > 0) &&
             (f_visit < LOCAL_QUEUE_SIZE)) {
           NodeId Q[LOCAL_QUEUE_SIZE];
@@ -49,14 +51,13 @@ class REACH {
           Q[tail++] = f;
           while (head < tail && tail < LOCAL_QUEUE_SIZE) {
             NodeId u = Q[head++];
-            size_t deg_u = G.offsets[u + 1] - G.offsets[u];
+            size_t deg_u = G.degree(u);
             if (deg_u > LOCAL_QUEUE_SIZE) {
               bag.insert(u);
               break;
             }
-            for (size_t j = G.offsets[u]; j < G.offsets[u + 1]; j++) {
-              NodeId v = G.edges[j].v;
-              if (!vist[v] && compare_and_swap(&vist[v], false, true)) {
+            G.map_neighbors(u, [&](NodeId v, auto) {
+              if (!vist.get(v) && !vist.test_and_set(v)) {
                 f_visit++;
                 if (f_visit < LOCAL_QUEUE_SIZE) {
                   Q[tail++] = v;
@@ -64,71 +65,75 @@ class REACH {
                   bag.insert(v);
                 }
               }
-            }
+            });
           }
           for (size_t j = head; j < tail; j++) {
             bag.insert(Q[j]);
           }
         } else if (deg_f > 0) {
-          parallel_for(G.offsets[f], G.offsets[f + 1],[&](size_t j) {
-            if (j>=G.edges.size()){
-              printf("offsets[f]:%lu offsets[f+1]&:%lu j: %zu, f:%u\n",G.offsets[f], G.offsets[f+1], j, f);
+          G.map_neighbors_parallel(f, [&](NodeId v, auto) {
+            if (!vist.get(v) && !vist.test_and_set(v)) {
+              bag.insert(v);
             }
-            assert(j<G.edges.size());
-            NodeId v = G.edges[j].v;
-            if (!vist[v] && compare_and_swap(&vist[v], false, true)){bag.insert(v);}
           },BLOCK_SIZE);
         }
       },1);
     return bag.pack_into(make_slice(frontier));
   }
 
-  size_t dense_visit(const Graph& GT, sequence<bool>& vist) {
-    parallel_for(0, GT.n, [&](size_t i) {
-      if (vist[i] == false) {
-        dense_frontier[i]=false;
-        for (size_t j = GT.offsets[i]; j < GT.offsets[i + 1]; j++) {
-          NodeId ngb_node = GT.edges[j].v;
-          if (vist[ngb_node]) {
-            vist[i] = true;
-            dense_frontier[i] = true;
-            break;}}
-      }else{
-        dense_frontier[i]=false;
+  // Every word of the bitmaps is updated by one thread, and words of 64
+  // visited vertices are skipped. Neighbor lists are checked against vist with
+  // the vectorized scan of neighbor_scan.h.
+  size_t dense_visit(const Graph& GT, bitmap& vist) {
+    parallel_for(0, vist.num_words(), [&](size_t w) {
+      uint64_t unvisited = ~vist.word(w) & vist.word_mask(w);
+      uint64_t found = 0;
+      while (unvisited) {
+        uint64_t bit = unvisited & -unvisited;
+        NodeId i = w * bitmap::WORD_BITS + __builtin_ctzll(unvisited);
+        unvisited &= unvisited - 1;
+        if (unvisited) {
+          prefetch_neighbors(
+              GT, w * bitmap::WORD_BITS + __builtin_ctzll(unvisited));
+        }
+        scan_neighbors_in(GT, i, vist, [&](NodeId) {
+          found |= bit;
+          vist.word(w) |= bit;
+          return true;});
       }
-    },BLOCK_SIZE);
-    return parlay::count(make_slice(dense_frontier), true);
+      dense_frontier.word(w) = found;
+    });
+    return dense_frontier.count();
   }
 
- void reach(NodeId source, const Graph& G, const Graph& GT, parlay::sequence<bool>&visit) {
-    parlay::parallel_for(0, G.n, [&](size_t i){visit[i]=false;});
+ void reach(NodeId source, const Graph& G, const Graph& GT, bitmap& visit) {
+    visit.clear();
     n_frontier = 0;
     frontier[n_frontier++] = source;
-    visit[source] = true;
+    visit.set(source);
     bool is_sparse = true;       // whether is sparse edge map
     num_round = 0;
     while (n_frontier > 0) {
       num_round++;
       if (is_sparse) {
         auto n_edges = parlay::reduce(parlay::delayed_map(frontier.cut(0, n_frontier), 
-                        [&] (NodeId i) {return G.offsets[i+1]-G.offsets[i];}));
+                        [&] (NodeId i) {return G.degree(i);}));
         if ((n_frontier + n_edges) > G.m/10) {
-          parallel_for(0, G.n, [&](NodeId i){dense_frontier[i]=false;});
-          parlay::for_each(frontier.cut(0, n_frontier),[&](NodeId v){dense_frontier[v]=true;});
+          dense_frontier.clear();
+          parlay::for_each(frontier.cut(0, n_frontier),
+                           [&](NodeId v) { dense_frontier.set(v); });
           is_sparse=false;
         } else is_sparse =true;
       } else {
         if (n_frontier > G.n/20) is_sparse = false;
         else {
-          // frontier = parlay::pack_index<NodeId>(dense_frontier);
-          auto identity = [](size_t i) -> NodeId { return static_cast<NodeId>(i); };
-          parlay::pack_into_uninitialized(parlay::delayed_tabulate(G.n,identity),dense_frontier, frontier);
+          dense_frontier.pack_into(frontier);
           is_sparse = true;}
       }
       n_frontier = (is_sparse)? sparse_visit(G, visit): dense_visit(GT, visit);
     }
   }
-  void verifier(const Graph& G, NodeId s, const sequence<bool> &act_dist) {
+  void verifier(const Graph& G, NodeId s, const bitmap &act_dist) {
     internal::timer t;
     size_t n = G.n;
     sequence<bool> exp_dist(n, false);
@@ -151,11 +156,11 @@ class REACH {
 
     assert(exp_dist.size() == act_dist.size());
     for (size_t i = 0; i < n; i++) {
-      if (exp_dist[i] != act_dist[i]) {
+      if (exp_dist[i] != act_dist.get(i)) {
         printf("exp_dist[%zu]: %u whlie act_dist[%zu]: %u\n", i, exp_dist[i], i,
-              act_dist[i]);
+              act_dist.get(i));
       }
-      assert(exp_dist[i] == act_dist[i]);
+      assert(exp_dist[i] == act_dist.get(i));
     }
     printf("Passed!\n");
   }
@@ -55,6 +55,9 @@ struct hash_table {
     parlay::internal::get_key(a)==parlay::internal::get_key(b) &&
     parlay::internal::get_val(a)==parlay::internal::get_val(b);}
   parlay::sequence<KV> H;
+  // Slots are read while other workers insert, and pairs of 64-bit ids are
+  // written in two stores, so they are read with atomic_read
+  KV slot(index i) { return atomic_read(&H[i]); }
   parlay::sequence<size_t> cts;
   size_t ne;
   bool overfull;
@@ -95,12 +98,12 @@ struct hash_table {
     KV kv = std::make_pair(k,v);
     index i = first_index(k);
     for (size_t count=0; count < 2000; count++) {
-      if (equal(H[i], empty) && atomic_compare_and_swap(&H[i],empty,kv)){
+      if (equal(slot(i), empty) && atomic_compare_and_swap(&H[i],empty,kv)){
         size_t wn = parlay::worker_id();
         cts[wn * kResizableTableCacheLineSz]++;
         return true;
       }
-      if (equal(H[i], kv)) return false;
+      if (equal(slot(i), kv)) return false;
 	    i = next_index(i);
 	  }
     // std::cout << "Hash table overfull" << std::endl;
@@ -112,8 +115,9 @@ struct hash_table {
     K k = parlay::internal::get_key(kv);
     index i = first_index(k);
     while (true) {
-      if (equal(H[i], empty)) return false;
-      if (equal(H[i], kv)) return true;
+      KV h = slot(i);
+      if (equal(h, empty)) return false;
+      if (equal(h, kv)) return true;
       i = next_index(i);
     }
   }
@@ -130,9 +134,10 @@ struct hash_table {
   bool init_iter(iter_k<K>& iter){
     index i = first_index(iter.k);
     while (true){
-      if (equal(H[i],empty)){
+      KV h = slot(i);
+      if (equal(h,empty)){
         return false;
-      }if (parlay::internal::get_key(H[i]) == iter.k){
+      }if (parlay::internal::get_key(h) == iter.k){
         iter.num_prob=0;
         iter.i=i;
         return true;
@@ -144,16 +149,18 @@ struct hash_table {
     while (iter.num_prob<m){
       iter.i = next_index(iter.i);
       iter.num_prob++;
-      if (equal(H[iter.i],empty)){
+      KV h = slot(iter.i);
+      if (equal(h,empty)){
         return false;
-      }if (parlay::internal::get_key(H[iter.i]) ==iter.k){
+      }if (parlay::internal::get_key(h) ==iter.k){
         return true;
       }
     }
     return false;
   }
   V get(iter_k<K>& iter){
-    return parlay::internal::get_val(H[iter.i]);
+    KV h = slot(iter.i);
+    return parlay::internal::get_val(h);
   }
   parlay::sequence<KV> pack(){
     return parlay::filter(H, [&](auto p){return p != empty;});
@@ -9,6 +9,13 @@
 
 #include "graph.h"
 
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
+typedef uint32_t NodeId;
+#endif
+typedef uint64_t EdgeId;
+
 constexpr int NUM_ROUND = 10;
 
 
@@ -37,11 +44,11 @@ int main(int argc, char *argv[]) {
   }
 
   printf("Reading graph...\n");
-  Graph G;
+  Graph<NodeId, EdgeId> G;
   // Graph G;
   // G.read_graph(input_path);
   G.read_graph(input_path);
-  auto GT = Transpose(G);
+  auto GT = Transpose(G, input_path);
   fprintf(stdout, "Running on %s: |V|=%zu, |E|=%zu, num_round=%d\n",
           input_path, G.n, G.m, NUM_ROUND);
   
@@ -22,9 +22,12 @@ class SCC {
 
   static constexpr NodeId UINT_N_MAX = std::numeric_limits<NodeId>::max();
 
-  // If top_bit is set, the vertex is not settle down
-  static constexpr size_t TOP_BIT = size_t(UINT_N_MAX) + 1;
-  static constexpr size_t VAL_MASK = UINT_N_MAX;
+  // If top_bit is set, the vertex is not settle down. It is the bit above the
+  // vertex ids, or the top bit of the label for 64-bit ids.
+  static constexpr size_t TOP_BIT = sizeof(NodeId) < sizeof(LabelT)
+                                        ? size_t(UINT_N_MAX) + 1
+                                        : size_t(1) << 63;
+  static constexpr size_t VAL_MASK = TOP_BIT - 1;
   static constexpr std::pair<NodeId, NodeId> EMPTY=std::pair(UINT_N_MAX,UINT_N_MAX);
 
   const Graph &G;
@@ -58,22 +61,25 @@ class SCC {
     NodeId source = P[0];
     // auto max_candidate = parlay::max_element(degree_product);
     // NodeId source = max_candidate - degree_product.begin();
-    printf("scc_first source: %u\n", source);
+    printf("scc_first source: %zu\n", static_cast<size_t>(source));
     REACH<Graph> reach_solver(G.n);
     // TODO: modify single reach to skip ZEROS
-    parlay::sequence<bool> forward_reach(G.n);
-    parlay::sequence<bool> backward_reach(G.n);
+    bitmap forward_reach(G.n);
+    bitmap backward_reach(G.n);
     reach_solver.reach(source, G, GT, forward_reach);
     reach_solver.reach(source, GT, G, backward_reach);
     parallel_for(0, G.n, [&](NodeId i){
-      if (forward_reach[i]&& backward_reach[i]){
+      if (forward_reach.get(i)&& backward_reach.get(i)){
         label[i]=label_offset | TOP_BIT;
-      }else if (!(TOP_BIT&label[i]) && (forward_reach[i]||backward_reach[i])){
+      }else if (!(TOP_BIT&label[i]) && (forward_reach.get(i)||backward_reach.get(i))){
         label[i]=label_offset;
       }
     });
-    return parlay::reduce(parlay::tabulate<size_t>(G.n, [&](NodeId i){
-      return (size_t)(forward_reach[i]&& backward_reach[i]);}));
+    return parlay::reduce(parlay::delayed_seq<size_t>(
+        forward_reach.num_words(), [&](size_t w) -> size_t {
+          return __builtin_popcountll(forward_reach.word(w) &
+                                      backward_reach.word(w));
+        }));
   }
   void scc(sequence<LabelT>& label){
     parlay::internal::timer t("scc");
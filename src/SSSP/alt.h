@@ -0,0 +1,143 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+
+#include "graph.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "sssp.h"
+
+using namespace std;
+using namespace parlay;
+
+// Distances from and to k landmark vertices, for the lower bounds of ALT
+// (A*, landmarks and the triangle inequality). The first landmark is a random
+// vertex, and each of the others is the vertex farthest from the landmarks
+// chosen before it, found with the solve of the previous landmark. Building
+// costs k Rho_Stepping solves on symmetrized graphs, and k more on the
+// transpose of other graphs, which need their in-CSR.
+template <class Graph, class DistTy = typename Graph::EdgeTy>
+class Landmarks {
+ public:
+  using NodeId = typename Graph::NodeId;
+
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
+
+ private:
+  size_t k;
+  bool symmetrized;
+  sequence<NodeId> landmarks;
+  // the distance from landmark i to v is from[v * k + i], and from v to
+  // landmark i is to[v * k + i], so that the bound of v reads one block.
+  // Symmetrized graphs keep only from.
+  sequence<DistTy> from, to;
+
+ public:
+  Landmarks() = delete;
+  Landmarks(const Graph &G, size_t _k, size_t rho = 1 << 20)
+      : k(min(_k, G.n)), symmetrized(G.symmetrized) {
+    if (k == 0) {
+      return;
+    }
+    landmarks = sequence<NodeId>(k);
+    from = sequence<DistTy>::uninitialized(G.n * k);
+    if (!symmetrized) {
+      to = sequence<DistTy>::uninitialized(G.n * k);
+    }
+    Rho_Stepping<Graph, DistTy> forward(G, rho);
+    // distance to the closest landmark so far, DIST_MAX if none reaches v
+    sequence<DistTy> closest(G.n, DIST_MAX);
+    landmarks[0] = hash32(G.n) % G.n;
+    for (size_t i = 0; i < k; i++) {
+      auto dist = forward.sssp(landmarks[i]);
+      parallel_for(0, G.n, [&](size_t v) {
+        from[v * k + i] = dist[v];
+        closest[v] = min(closest[v], dist[v]);
+      });
+      if (i + 1 < k) {
+        auto farthest = delayed_seq<DistTy>(G.n, [&](size_t v) {
+          return closest[v] == DIST_MAX ? 0 : closest[v];
+        });
+        auto it = max_element(farthest);
+        // every reached vertex is a landmark, so try another component
+        landmarks[i + 1] = *it == 0 ? hash32(G.n + i + 1) % G.n
+                                    : it - farthest.begin();
+      }
+    }
+    if (!symmetrized) {
+      TransposedGraph<Graph> GT(G);
+      Rho_Stepping<TransposedGraph<Graph>, DistTy> backward(GT, rho);
+      for (size_t i = 0; i < k; i++) {
+        auto dist = backward.sssp(landmarks[i]);
+        parallel_for(0, G.n, [&](size_t v) { to[v * k + i] = dist[v]; });
+      }
+    }
+  }
+
+  size_t size() const { return k; }
+  const sequence<NodeId> &vertices() const { return landmarks; }
+
+  // A lower bound on the distance from v to t. For every landmark L,
+  // d(L, t) <= d(L, v) + d(v, t) and d(v, L) <= d(v, t) + d(t, L). The
+  // maximum over landmarks is consistent, so keys along an edge never
+  // decrease by more than its weight.
+  DistTy lower_bound(NodeId v, NodeId t) const {
+    const DistTy *from_v = from.data() + (size_t)v * k;
+    const DistTy *from_t = from.data() + (size_t)t * k;
+    const DistTy *to_v = (symmetrized ? from : to).data() + (size_t)v * k;
+    const DistTy *to_t = (symmetrized ? from : to).data() + (size_t)t * k;
+    DistTy bound = 0;
+    for (size_t i = 0; i < k; i++) {
+      if (from_v[i] != DIST_MAX && from_t[i] != DIST_MAX &&
+          from_t[i] > from_v[i]) {
+        bound = max<DistTy>(bound, from_t[i] - from_v[i]);
+      }
+      if (to_v[i] != DIST_MAX && to_t[i] != DIST_MAX && to_v[i] > to_t[i]) {
+        bound = max<DistTy>(bound, to_v[i] - to_t[i]);
+      }
+    }
+    return bound;
+  }
+};
+
+// Goal-directed point-to-point SSSP: a stepping search whose frontier is
+// ordered by dist[v] plus the landmark bound from v to t, so the thresholds
+// of Rho_Stepping prefer vertices on the way to t, and the search stops once
+// no key in the frontier is below dist[t]. Bounds are computed when a vertex
+// is first ordered and reset with the search. Weights must be nonnegative.
+//
+// Stepping is the search that is directed (Rho_Stepping by default). Delta
+// and Bellman-Ford thresholds are correct but do not gain from the keys.
+template <class Graph, class DistTy = typename Graph::EdgeTy,
+          template <class, class> class Stepping = Rho_Stepping>
+class ALT : public Stepping<Graph, DistTy> {
+  using NodeId = typename Graph::NodeId;
+  using Base = SSSP<Graph, DistTy>;
+
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
+
+  const Landmarks<Graph, DistTy> &landmarks;
+  NodeId target;
+
+  DistTy compute_potential(NodeId v) override {
+    return landmarks.lower_bound(v, target);
+  }
+
+ public:
+  using Base::distance;
+
+  ALT() = delete;
+  template <class... Args>
+  ALT(const Graph &G, const Landmarks<Graph, DistTy> &_landmarks,
+      Args... args)
+      : Stepping<Graph, DistTy>(G, args...), landmarks(_landmarks) {
+    this->potential = sequence<DistTy>(G.n, DIST_MAX);
+  }
+
+  // Distance from s to t, DIST_MAX if t is unreachable
+  DistTy distance(NodeId s, NodeId t) {
+    target = t;
+    Base &base = *this;
+    return base.distance(s, t);
+  }
+};
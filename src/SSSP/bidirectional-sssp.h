@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+
+#include "graph.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "sssp.h"
+
+using namespace std;
+using namespace parlay;
+
+// Point-to-point SSSP that runs a stepping search forward from s along
+// out-edges and another one backward from t along in-edges (on the transpose),
+// one round at a time on the side with the smaller frontier. Both sides keep
+// mu, the length of the shortest s-t path through a vertex reached by both,
+// up to date whenever they lower a distance. Between rounds, every path that
+// is not yet found must leave the forward frontier and enter the backward
+// one, so the search stops once the smallest distances of the two frontiers
+// add up to mu, or one side runs out of frontier. Weights must be
+// nonnegative, and directed graphs need their in-CSR.
+//
+// Stepping is the search run on both sides (Rho_Stepping, Delta_Stepping or
+// Bellman_Ford), and the arguments of the constructor after the graph are
+// passed to both of them.
+template <class Graph, class DistTy = typename Graph::EdgeTy,
+          template <class, class> class Stepping = Rho_Stepping>
+class Bidirectional_SSSP {
+ public:
+  using NodeId = typename Graph::NodeId;
+
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
+
+ private:
+  using Forward = SSSP<Graph, DistTy>;
+  using Backward = SSSP<TransposedGraph<Graph>, DistTy>;
+
+  TransposedGraph<Graph> GT;
+  Stepping<Graph, DistTy> forward_search;
+  Stepping<TransposedGraph<Graph>, DistTy> backward_search;
+  DistTy mu;
+
+ public:
+  Bidirectional_SSSP() = delete;
+  template <class... Args>
+  Bidirectional_SSSP(const Graph &G, Args... args)
+      : GT(G), forward_search(G, args...), backward_search(GT, args...) {
+    // the stepping searches may hide the members of SSSP
+    Forward &forward = forward_search;
+    Backward &backward = backward_search;
+    forward.other_dist = backward.dist.data();
+    forward.meet_dist = &mu;
+    backward.other_dist = forward.dist.data();
+    backward.meet_dist = &mu;
+  }
+
+  // Distance from s to t, DIST_MAX if t is unreachable
+  DistTy distance(NodeId s, NodeId t) {
+    Forward &forward = forward_search;
+    Backward &backward = backward_search;
+    forward.track_visited();
+    backward.track_visited();
+    forward.start(s);
+    backward.start(t);
+    mu = s == t ? 0 : DIST_MAX;
+    while (forward.frontier_size && backward.frontier_size) {
+      if (mu != DIST_MAX) {
+        DistTy lower = forward.frontier_min() + backward.frontier_min();
+        if (lower >= mu) {
+          break;
+        }
+      }
+      if (forward.frontier_size <= backward.frontier_size) {
+        forward.step();
+      } else {
+        backward.step();
+      }
+    }
+    forward.finish();
+    backward.finish();
+    return mu;
+  }
+
+  void set_prefetch_distance(size_t d) {
+    forward_search.set_prefetch_distance(d);
+    backward_search.set_prefetch_distance(d);
+  }
+};
@@ -0,0 +1,249 @@
+#include "contraction-hierarchy.h"
+
+#include <queue>
+#include <type_traits>
+
+#include "dijkstra.h"
+#include "graph.h"
+#include "sssp.h"
+
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
+typedef uint32_t NodeId;
+#endif
+typedef uint64_t EdgeId;
+// Distances are as wide as weights unless built with DIST64
+#ifdef FLOAT
+typedef float EdgeTy;
+#ifdef DIST64
+typedef double DistTy;
+#else
+typedef float DistTy;
+#endif
+#else
+#ifdef WEIGHT16
+typedef uint16_t EdgeTy;
+#else
+typedef uint32_t EdgeTy;
+#endif
+#ifdef DIST64
+typedef uint64_t DistTy;
+#else
+typedef uint32_t DistTy;
+#endif
+#endif
+constexpr NodeId NO_SOURCE = numeric_limits<NodeId>::max();
+constexpr int NUM_SRC = 10;
+constexpr int NUM_ROUND = 5;
+// random weights must fit in EdgeTy
+constexpr int LOG2_WEIGHT = min<int>(18, sizeof(EdgeTy) * 8 - 1);
+constexpr int WEIGHT_RANGE = 1 << LOG2_WEIGHT;
+
+// Shortcuts add up weights in another order than Dijkstra does, so
+// floating-point distances may differ in the last bits
+bool same_distance(DistTy a, DistTy b) {
+  if constexpr (is_floating_point_v<DistTy>) {
+    return a == b || fabs(a - b) <= 1e-5 * max(a, b);
+  } else {
+    return a == b;
+  }
+}
+
+template <class F>
+double time_rounds(F &&f) {
+  double total_time = 0;
+  for (int i = 0; i <= NUM_ROUND; i++) {
+    internal::timer t;
+    f();
+    t.stop();
+    if (i == 0) {
+      printf("Warmup Round: %f\n", t.total_time());
+    } else {
+      printf("Round %d: %f\n", i, t.total_time());
+      total_time += t.total_time();
+    }
+  }
+  return total_time / NUM_ROUND;
+}
+
+// Times the query from s to t on the hierarchy and the s-t search of
+// Rho_Stepping, which stops once t is settled, and returns the average time
+// of the former
+template <class Query, class Solver, class Graph>
+double run_query(Query &query, Solver &solver, [[maybe_unused]] const Graph &G,
+                 NodeId s, NodeId t, bool verify) {
+  printf("source %-10zu target %-10zu\n", static_cast<size_t>(s),
+         static_cast<size_t>(t));
+  DistTy d = 0, rho_d = 0;
+  double ch_time = time_rounds([&] { d = query.distance(s, t); });
+  printf("Average CH time: %f\n", ch_time);
+  double rho_time = time_rounds([&] { rho_d = solver.distance(s, t); });
+  printf("Average rho-stepping time: %f\n", rho_time);
+  if (d == numeric_limits<DistTy>::max()) {
+    printf("Distance: unreachable\n");
+  } else {
+    cout << "Distance: " << d << endl;
+  }
+
+  ofstream ofs("ch.tsv", ios_base::app);
+  ofs << s << '\t' << t << '\t' << ch_time << '\t' << rho_time << '\n';
+  ofs.close();
+
+  if (verify) {
+    printf("Running verifier...\n");
+    Dijkstra<Graph, DistTy> verifier(G);
+    DistTy exp_d = verifier.dijkstra(s)[t];
+    assert(same_distance(d, exp_d) && rho_d == exp_d);
+    printf("Passed!\n");
+  }
+  printf("\n");
+  return ch_time;
+}
+
+// Times the table query between k random sources and k random targets, and
+// k Rho_Stepping searches from the sources
+template <class Query, class Solver, class Graph>
+void run_table(Query &query, Solver &solver, [[maybe_unused]] const Graph &G,
+               size_t k, bool verify) {
+  auto sources =
+      tabulate(k, [&](size_t i) { return NodeId(hash32(2 * i) % G.n); });
+  auto targets =
+      tabulate(k, [&](size_t i) { return NodeId(hash32(2 * i + 1) % G.n); });
+  printf("Table of %zu sources and %zu targets\n", k, k);
+  sequence<DistTy> table;
+  double ch_time = time_rounds([&] { table = query.table(sources, targets); });
+  printf("Average CH table time: %f\n", ch_time);
+  internal::timer t;
+  for (size_t i = 0; i < k; i++) {
+    solver.sssp(sources[i]);
+  }
+  t.stop();
+  printf("Rho-stepping time for %zu sources: %f\n", k, t.total_time());
+
+  ofstream ofs("ch.tsv", ios_base::app);
+  ofs << "table" << '\t' << k << '\t' << ch_time << '\t' << t.total_time()
+      << '\n';
+  ofs.close();
+
+  if (verify) {
+    printf("Running verifier...\n");
+    Dijkstra<Graph, DistTy> verifier(G);
+    for (size_t i = 0; i < k; i++) {
+      auto dist = verifier.dijkstra(sources[i]);
+      for (size_t j = 0; j < k; j++) {
+        assert(same_distance(table[i * k + j], dist[targets[j]]));
+      }
+    }
+    printf("Passed!\n");
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  if (argc == 1) {
+    fprintf(stderr,
+            "Usage: %s [-i input_file] [-s] [-v] [-c hierarchy_file] "
+            "[-r source] [-q target] [-m table_size]\n"
+            "Options:\n"
+            "\t-i,\tinput file path\n"
+            "\t-s,\tsymmetrized input graph\n"
+            "\t-v,\tverify result\n"
+            "\t-c,\tread the contraction hierarchy from this file, or build "
+            "and write it\n"
+            "\t-r,\tsource vertex, with -q (default: %d random pairs)\n"
+            "\t-q,\ttarget vertex, with -r\n"
+            "\t-m,\talso time a table query between this many random sources "
+            "and targets\n",
+            argv[0], NUM_SRC);
+    return 0;
+  }
+  char c;
+  char const *input_path = nullptr;
+  char const *hierarchy_path = nullptr;
+  NodeId source = NO_SOURCE;
+  NodeId target = NO_SOURCE;
+  size_t table_size = 0;
+  bool symmetrized = false;
+  bool verify = false;
+  while ((c = getopt(argc, argv, "i:c:r:q:m:sv")) != -1) {
+    switch (c) {
+      case 'i':
+        input_path = optarg;
+        break;
+      case 'c':
+        hierarchy_path = optarg;
+        break;
+      case 'r':
+        source = atol(optarg);
+        break;
+      case 'q':
+        target = atol(optarg);
+        break;
+      case 'm':
+        table_size = atol(optarg);
+        break;
+      case 's':
+        symmetrized = true;
+        break;
+      case 'v':
+        verify = true;
+        break;
+      default:
+        std::cerr << "Error: Unknown option " << optopt << std::endl;
+        abort();
+    }
+  }
+
+  printf("Reading graph...\n");
+  Graph<NodeId, EdgeId, EdgeTy> G;
+  G.symmetrized = symmetrized;
+  if (!strcmp(input_path, "random")) {
+    G.generate_random_graph();
+  } else {
+    G.read_graph(input_path);
+  }
+  if (!G.weighted) {
+    printf("Generating edge weights...\n");
+    G.generate_random_weight(1, WEIGHT_RANGE);
+  }
+
+  fprintf(stdout, "Running on %s: |V|=%zu, |E|=%zu, num_src=%d, num_round=%d\n",
+          input_path, G.n, G.m, NUM_SRC, NUM_ROUND);
+
+  using Hierarchy = ContractionHierarchy<decltype(G), DistTy>;
+  Hierarchy CH;
+  if (hierarchy_path && CH.read(hierarchy_path, G)) {
+    printf("Loaded contraction hierarchy from %s\n", hierarchy_path);
+  } else {
+    printf("Contracting graph...\n");
+    internal::timer t;
+    CH = Hierarchy(G);
+    t.stop();
+    printf("Contraction time: %f\n", t.total_time());
+    if (hierarchy_path) {
+      CH.write(hierarchy_path, G);
+    }
+  }
+  printf("Upward edges: %zu (%.2f per edge)\n", CH.num_up_edges(),
+         1.0 * CH.num_up_edges() / max<size_t>(G.m, 1));
+
+  CH_Query<decltype(G), DistTy> query(CH);
+  Rho_Stepping<decltype(G), DistTy> solver(G);
+  if (source != NO_SOURCE && target != NO_SOURCE) {
+    run_query(query, solver, G, source, target, verify);
+  } else {
+    double total_time = 0;
+    for (int v = 0; v < NUM_SRC; v++) {
+      NodeId s = hash32(2 * v) % G.n;
+      NodeId t = hash32(2 * v + 1) % G.n;
+      total_time += run_query(query, solver, G, s, t, verify);
+    }
+    printf("Average CH time over %d pairs: %f\n\n", NUM_SRC,
+           total_time / NUM_SRC);
+  }
+  if (table_size) {
+    run_table(query, solver, G, table_size, verify);
+  }
+  return 0;
+}
@@ -0,0 +1,723 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <queue>
+#include <vector>
+
+#include "graph.h"
+#include "mmap_array.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "utils.h"
+
+using namespace std;
+using namespace parlay;
+
+// Header of the binary file of a contraction hierarchy. It is followed by
+// rank[n], up_offsets[n + 1], up_edges[m_up], down_offsets[n + 1] and
+// down_edges[m_down] as stored in memory, each starting at a multiple of 8
+// bytes. Symmetrized hierarchies store no down edges. A file is only valid for
+// the graph with the same checksum, stored with the same types.
+struct CHHeader {
+  static constexpr uint64_t MAGIC = 0x48434c4147534150;  // "PASGALCH"
+  static constexpr uint32_t VERSION = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint8_t node_id_bytes;
+  uint8_t edge_id_bytes;
+  uint8_t edge_bytes;
+  uint8_t dist_type;
+  uint64_t n;
+  uint64_t m_up;
+  uint64_t m_down;
+  uint64_t symmetrized;
+  uint64_t checksum;  // checksum of the graph the hierarchy was built from
+
+  static size_t align(size_t bytes) { return (bytes + 7) / 8 * 8; }
+  size_t rank_pos() const { return sizeof(CHHeader); }
+  size_t up_offsets_pos() const {
+    return rank_pos() + align(n * node_id_bytes);
+  }
+  size_t up_edges_pos() const {
+    return up_offsets_pos() + align((n + 1) * edge_id_bytes);
+  }
+  size_t down_offsets_pos() const {
+    return up_edges_pos() + align(m_up * edge_bytes);
+  }
+  size_t down_edges_pos() const {
+    return down_offsets_pos() + align((n + 1) * edge_id_bytes);
+  }
+  size_t file_size() const {
+    return down_edges_pos() + align(m_down * edge_bytes);
+  }
+};
+static_assert(sizeof(CHHeader) == 56);
+
+// Distances of a local search, which reaches few vertices of a large graph,
+// in an open-addressing hash table. It is cleared in time proportional to the
+// vertices it holds, so one table serves many searches.
+template <class NodeId, class DistTy>
+class LocalDistances {
+  static constexpr NodeId EMPTY = numeric_limits<NodeId>::max();
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
+
+  vector<pair<NodeId, DistTy>> table;
+  vector<size_t> used;
+
+  size_t slot(NodeId v) const {
+    size_t mask = table.size() - 1;
+    size_t i = hash32(v) & mask;
+    while (table[i].first != EMPTY && table[i].first != v) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+ public:
+  LocalDistances() : table(64, make_pair(EMPTY, DIST_MAX)) {}
+
+  // DIST_MAX if v was not reached
+  DistTy get(NodeId v) const { return table[slot(v)].second; }
+
+  // Lowers the distance of v to d, and returns whether it was larger
+  bool lower(NodeId v, DistTy d) {
+    size_t i = slot(v);
+    if (table[i].first == EMPTY) {
+      if (2 * (used.size() + 1) > table.size()) {
+        auto old = std::move(table);
+        table.assign(2 * old.size(), make_pair(EMPTY, DIST_MAX));
+        for (size_t &j : used) {
+          size_t k = slot(old[j].first);
+          table[k] = old[j];
+          j = k;
+        }
+        i = slot(v);
+      }
+      table[i].first = v;
+      used.push_back(i);
+    }
+    if (d < table[i].second) {
+      table[i].second = d;
+      return true;
+    }
+    return false;
+  }
+
+  void clear() {
+    for (size_t i : used) {
+      table[i] = make_pair(EMPTY, DIST_MAX);
+    }
+    used.clear();
+  }
+};
+
+// Contracts the vertices of a graph in rounds. Every round takes the
+// uncontracted vertices whose priority is lower than that of all their
+// uncontracted neighbors, which form an independent set, and contracts them
+// in parallel: each one adds a shortcut (u, w) of length d(u, v) + d(v, w)
+// for every in-neighbor u and out-neighbor w, unless a witness search finds a
+// path from u to w that is as short and avoids the vertices of the round.
+// The priority of a vertex is the number of shortcuts it would add minus its
+// degree, plus its depth, one more than that of the deepest contracted
+// neighbor, which keeps the hierarchy shallow. Priorities are recomputed for
+// the neighbors of the contracted vertices.
+//
+// When a vertex is contracted, its remaining out- and in-edges all lead to
+// vertices contracted later, and they are its upward and downward edges in
+// the hierarchy. Edge lists are kept sorted by neighbor, so shortcuts are
+// merged into them in linear time.
+template <class Graph, class DistTy = typename Graph::EdgeTy>
+class CH_Builder {
+ public:
+  using NodeId = typename Graph::NodeId;
+  using Edge = WEdge<NodeId, DistTy>;
+
+ private:
+  // witness searches settle at most this many vertices, so they may add
+  // unneeded shortcuts but never miss a needed one. Searches that only
+  // estimate priorities stop earlier.
+  static constexpr size_t WITNESS_LIMIT = 500;
+  static constexpr size_t ESTIMATE_LIMIT = 50;
+
+  // The distances and heap of the witness searches of one worker, reused by
+  // all of its searches. Each is on its own cache lines (kept in a vector,
+  // whose allocator respects the alignment).
+  struct alignas(64) Workspace {
+    LocalDistances<NodeId, DistTy> dist;
+    vector<pair<DistTy, NodeId>> heap;
+  };
+
+  size_t n;
+  // the edges between uncontracted vertices, original or shortcuts, and the
+  // final edges of the contracted vertices, sorted by neighbor
+  sequence<sequence<Edge>> out, in;
+  mutable vector<Workspace> workspaces;
+  sequence<bool> contracted;
+  sequence<bool> selected;
+  sequence<int64_t> priority;
+  sequence<uint32_t> depth;
+  sequence<NodeId> rank;
+
+  // Merges the edges in pairs, a sequence of (u, e), into the sorted
+  // lists[u], keeping the shortest edge to each neighbor
+  void merge_into(sequence<pair<NodeId, Edge>> &pairs,
+                  sequence<sequence<Edge>> &lists) {
+    sort_inplace(pairs, [](const auto &a, const auto &b) {
+      if (a.first != b.first) {
+        return a.first < b.first;
+      }
+      return a.second < b.second;
+    });
+    auto starts =
+        pack_index<size_t>(delayed_seq<bool>(pairs.size(), [&](size_t i) {
+          return i == 0 || pairs[i].first != pairs[i - 1].first;
+        }));
+    parallel_for(0, starts.size(), [&](size_t i) {
+      size_t start = starts[i];
+      size_t end = i + 1 < starts.size() ? starts[i + 1] : pairs.size();
+      auto &list = lists[pairs[start].first];
+      sequence<Edge> merged;
+      merged.reserve(list.size() + end - start);
+      size_t k = 0;
+      for (size_t j = start; j < end; j++) {
+        const Edge &e = pairs[j].second;
+        // sorted by weight within a neighbor, so the first one is the shortest
+        if (j > start && e.v == pairs[j - 1].second.v) {
+          continue;
+        }
+        while (k < list.size() && list[k].v < e.v) {
+          merged.push_back(list[k++]);
+        }
+        if (k < list.size() && list[k].v == e.v) {
+          merged.push_back(list[k].w < e.w ? list[k] : e);
+          k++;
+        } else {
+          merged.push_back(e);
+        }
+      }
+      while (k < list.size()) {
+        merged.push_back(list[k++]);
+      }
+      list = std::move(merged);
+    });
+  }
+
+  // Local Dijkstra from s that skips v and the vertices of the current round.
+  // It stops after max_settled vertices, at distance limit, or once it
+  // settled the targets of all edges in targets (sorted by target), and
+  // leaves the length of a path to every vertex it reached in w.dist.
+  void witness_search(NodeId s, NodeId v, DistTy limit, size_t max_settled,
+                      const sequence<Edge> &targets, Workspace &w) const {
+    auto &dist = w.dist;
+    auto &heap = w.heap;
+    auto greater = std::greater<pair<DistTy, NodeId>>();
+    heap.clear();
+    dist.clear();
+    dist.lower(s, 0);
+    heap.push_back(make_pair(0, s));
+    size_t settled = 0, settled_targets = 0;
+    while (!heap.empty() && settled < max_settled &&
+           settled_targets < targets.size()) {
+      pop_heap(heap.begin(), heap.end(), greater);
+      auto [d, u] = heap.back();
+      heap.pop_back();
+      if (d > limit) {
+        break;
+      }
+      if (d > dist.get(u)) {
+        continue;
+      }
+      settled++;
+      auto it = lower_bound(
+          targets.begin(), targets.end(), u,
+          [](const Edge &e, NodeId target) { return e.v < target; });
+      if (it != targets.end() && it->v == u) {
+        settled_targets++;
+      }
+      for (const Edge &e : out[u]) {
+        if (e.v == v || selected[e.v]) {
+          continue;
+        }
+        DistTy nd = d + e.w;
+        if (dist.lower(e.v, nd)) {
+          heap.push_back(make_pair(nd, e.v));
+          push_heap(heap.begin(), heap.end(), greater);
+        }
+      }
+    }
+  }
+
+  // Calls f(u, w, d) for the shortcuts that contracting v adds, with witness
+  // searches that settle at most max_settled vertices. The searches use the
+  // workspace of the calling worker, which runs no other task meanwhile.
+  template <class F>
+  void find_shortcuts(NodeId v, size_t max_settled, F &&f) const {
+    DistTy max_out = 0;
+    for (const Edge &e : out[v]) {
+      max_out = max(max_out, e.w);
+    }
+    Workspace &workspace = workspaces[worker_id()];
+    for (const Edge &e_in : in[v]) {
+      NodeId u = e_in.v;
+      witness_search(u, v, e_in.w + max_out, max_settled, out[v], workspace);
+      for (const Edge &e_out : out[v]) {
+        NodeId w = e_out.v;
+        if (w == u) {
+          continue;
+        }
+        DistTy d = e_in.w + e_out.w;
+        if (workspace.dist.get(w) > d) {
+          f(u, w, d);
+        }
+      }
+    }
+  }
+
+  void update_priority(NodeId v) {
+    int64_t shortcuts = 0;
+    find_shortcuts(v, ESTIMATE_LIMIT,
+                   [&](NodeId, NodeId, DistTy) { shortcuts++; });
+    priority[v] = shortcuts - static_cast<int64_t>(out[v].size()) -
+                  static_cast<int64_t>(in[v].size()) + depth[v];
+  }
+
+  // Ties are broken by a hash, so the order is strict
+  bool before(NodeId u, NodeId v) const {
+    if (priority[u] != priority[v]) {
+      return priority[u] < priority[v];
+    }
+    uint32_t hu = hash32(u), hv = hash32(v);
+    return hu != hv ? hu < hv : u < v;
+  }
+
+ public:
+  CH_Builder() = delete;
+  CH_Builder(const Graph &G) : n(G.n) {
+    out = sequence<sequence<Edge>>(n);
+    in = sequence<sequence<Edge>>(n);
+    contracted = sequence<bool>(n, false);
+    selected = sequence<bool>(n, false);
+    priority = sequence<int64_t>(n);
+    depth = sequence<uint32_t>(n, 0);
+    rank = sequence<NodeId>::uninitialized(n);
+    workspaces = vector<Workspace>(num_workers());
+
+    // self-loops are dropped and parallel edges reduced to the shortest one
+    auto edges = flatten(tabulate(n, [&](NodeId u) {
+      sequence<pair<NodeId, Edge>> ret;
+      G.map_neighbors(u, [&](NodeId v, auto w) {
+        if (u != v) {
+          ret.push_back(make_pair(u, Edge(v, w)));
+        }
+      });
+      return ret;
+    }));
+    merge_into(edges, out);
+    if (G.symmetrized) {
+      in = out;
+    } else {
+      auto reversed = parlay::map(edges, [](const pair<NodeId, Edge> &p) {
+        return make_pair(p.second.v, Edge(p.first, p.second.w));
+      });
+      merge_into(reversed, in);
+    }
+  }
+
+  // Contracts all vertices, and returns the rank of each vertex and its
+  // upward and downward edges
+  tuple<sequence<NodeId>, sequence<sequence<Edge>>, sequence<sequence<Edge>>>
+  contract() {
+    parallel_for(0, n, [&](NodeId v) { update_priority(v); }, 1);
+    auto remaining = tabulate(n, [](NodeId v) { return v; });
+    size_t num_contracted = 0;
+    while (remaining.size()) {
+      auto batch = filter(remaining, [&](NodeId v) {
+        // the lowest vertex is always taken, even if the edge lists of a
+        // graph marked as symmetrized are not
+        auto lower = [&](const Edge &e) {
+          return contracted[e.v] || before(v, e.v);
+        };
+        return all_of(out[v], lower) && all_of(in[v], lower);
+      });
+      parallel_for(0, batch.size(), [&](size_t i) {
+        selected[batch[i]] = true;
+        rank[batch[i]] = num_contracted + i;
+      });
+      auto shortcuts = flatten(tabulate(
+          batch.size(),
+          [&](size_t i) {
+            sequence<pair<NodeId, Edge>> ret;
+            find_shortcuts(batch[i], WITNESS_LIMIT,
+                           [&](NodeId u, NodeId w, DistTy d) {
+                             ret.push_back(make_pair(u, Edge(w, d)));
+                           });
+            return ret;
+          },
+          1));
+
+      // the neighbors of the round lose their edges to it and get deeper
+      auto neighbors = flatten(parlay::map(batch, [&](NodeId v) {
+        sequence<NodeId> ret;
+        for (const Edge &e : out[v]) {
+          ret.push_back(e.v);
+        }
+        for (const Edge &e : in[v]) {
+          ret.push_back(e.v);
+        }
+        return ret;
+      }));
+      parallel_for(0, batch.size(), [&](size_t i) {
+        NodeId v = batch[i];
+        contracted[v] = true;
+        selected[v] = false;
+        for (const Edge &e : out[v]) {
+          write_max(&depth[e.v], depth[v] + 1);
+        }
+        for (const Edge &e : in[v]) {
+          write_max(&depth[e.v], depth[v] + 1);
+        }
+      });
+      sort_inplace(neighbors);
+      auto affected = pack(neighbors, delayed_seq<bool>(
+                                          neighbors.size(), [&](size_t i) {
+                                            return i == 0 ||
+                                                   neighbors[i] !=
+                                                       neighbors[i - 1];
+                                          }));
+      parallel_for(0, affected.size(), [&](size_t i) {
+        NodeId x = affected[i];
+        auto remains = [&](const Edge &e) { return !contracted[e.v]; };
+        out[x] = filter(out[x], remains);
+        in[x] = filter(in[x], remains);
+      });
+      auto reversed = parlay::map(shortcuts, [](const pair<NodeId, Edge> &p) {
+        return make_pair(p.second.v, Edge(p.first, p.second.w));
+      });
+      merge_into(shortcuts, out);
+      merge_into(reversed, in);
+      parallel_for(
+          0, affected.size(), [&](size_t i) { update_priority(affected[i]); },
+          1);
+
+      num_contracted += batch.size();
+      remaining = filter(remaining, [&](NodeId v) { return !contracted[v]; });
+    }
+    return {std::move(rank), std::move(out), std::move(in)};
+  }
+};
+
+// A contraction hierarchy of a graph with nonnegative weights (see
+// CH_Builder). The upward edges of u are the edges (u, v), original or
+// shortcuts, with rank[v] > rank[u]. The downward edges of u are the edges
+// (v, u) with rank[v] > rank[u], stored as (v, w) so that backward searches
+// also go upward. Symmetrized hierarchies use the upward edges for both.
+template <class Graph, class DistTy = typename Graph::EdgeTy>
+class ContractionHierarchy {
+ public:
+  using NodeId = typename Graph::NodeId;
+  using EdgeId = typename Graph::EdgeId;
+  using Edge = WEdge<NodeId, DistTy>;
+
+  size_t n;
+  bool symmetrized;
+  mmap_array<NodeId> rank;
+  mmap_array<EdgeId> up_offsets;
+  mmap_array<Edge> up_edges;
+  mmap_array<EdgeId> down_offsets;
+  mmap_array<Edge> down_edges;
+
+ private:
+  static pair<sequence<EdgeId>, sequence<Edge>> to_csr(
+      const sequence<sequence<Edge>> &lists) {
+    auto offsets = sequence<EdgeId>(lists.size() + 1);
+    parallel_for(0, lists.size(),
+                 [&](size_t i) { offsets[i] = lists[i].size(); });
+    offsets[lists.size()] = 0;
+    scan_inplace(make_slice(offsets));
+    return {std::move(offsets), flatten(lists)};
+  }
+
+  CHHeader ch_header(uint64_t checksum) const {
+    CHHeader header;
+    header.magic = CHHeader::MAGIC;
+    header.version = CHHeader::VERSION;
+    header.node_id_bytes = sizeof(NodeId);
+    header.edge_id_bytes = sizeof(EdgeId);
+    header.edge_bytes = sizeof(Edge);
+    header.dist_type = weight_type_code<DistTy>();
+    header.n = n;
+    header.m_up = up_edges.size();
+    header.m_down = down_edges.size();
+    header.symmetrized = symmetrized;
+    header.checksum = checksum;
+    return header;
+  }
+
+ public:
+  ContractionHierarchy() : n(0), symmetrized(false) {}
+
+  // Builds the hierarchy of G, whose weights must be nonnegative
+  ContractionHierarchy(const Graph &G) : n(G.n), symmetrized(G.symmetrized) {
+    if (!G.weighted) {
+      fprintf(stderr, "Error: Input graph is unweighted\n");
+      exit(EXIT_FAILURE);
+    }
+    CH_Builder<Graph, DistTy> builder(G);
+    auto [_rank, up, down] = builder.contract();
+    rank = std::move(_rank);
+    std::tie(up_offsets, up_edges) = to_csr(up);
+    if (!symmetrized) {
+      std::tie(down_offsets, down_edges) = to_csr(down);
+    }
+  }
+
+  size_t num_up_edges() const { return up_edges.size(); }
+
+  template <class F>
+  void map_up(NodeId u, F &&f) const {
+    for (EdgeId i = up_offsets[u]; i < up_offsets[u + 1]; i++) {
+      f(up_edges[i].v, up_edges[i].w);
+    }
+  }
+
+  template <class F>
+  void map_down(NodeId u, F &&f) const {
+    if (symmetrized) {
+      map_up(u, f);
+      return;
+    }
+    for (EdgeId i = down_offsets[u]; i < down_offsets[u + 1]; i++) {
+      f(down_edges[i].v, down_edges[i].w);
+    }
+  }
+
+  // Maps the hierarchy stored in filename, and returns whether it was built
+  // from G
+  bool read(const char *filename, const Graph &G) {
+    if (access(filename, R_OK) != 0) {
+      return false;
+    }
+    auto file = std::make_shared<mapped_file>(filename);
+    CHHeader stored;
+    memset(&stored, 0, sizeof(CHHeader));
+    memcpy(&stored, file->data(), min(file->size(), sizeof(CHHeader)));
+    *this = ContractionHierarchy();
+    n = G.n;
+    symmetrized = G.symmetrized;
+    CHHeader expected = ch_header(G.checksum());
+    expected.m_up = stored.m_up;
+    expected.m_down = stored.m_down;
+    if (file->size() != expected.file_size() ||
+        memcmp(&stored, &expected, sizeof(CHHeader)) != 0) {
+      printf("Warning: ignoring stale contraction hierarchy %s\n", filename);
+      *this = ContractionHierarchy();
+      return false;
+    }
+    rank = mmap_array<NodeId>(file, stored.rank_pos(), n);
+    up_offsets = mmap_array<EdgeId>(file, stored.up_offsets_pos(), n + 1);
+    up_edges = mmap_array<Edge>(file, stored.up_edges_pos(), stored.m_up);
+    if (!symmetrized) {
+      down_offsets =
+          mmap_array<EdgeId>(file, stored.down_offsets_pos(), n + 1);
+      down_edges =
+          mmap_array<Edge>(file, stored.down_edges_pos(), stored.m_down);
+    }
+    return true;
+  }
+
+  // Writes the hierarchy of G to filename
+  void write(const char *filename, const Graph &G) const {
+    // Writes a temporary file of this run, header last, and renames it over
+    // filename once complete, so that concurrent runs never map a partially
+    // written hierarchy (see output_file::open_temporary)
+    CHHeader h = ch_header(G.checksum());
+    output_file file;
+    if (!file.open_temporary(filename, h.file_size())) {
+      printf("Warning: cannot write contraction hierarchy %s\n", filename);
+      return;
+    }
+    file.write_array(rank.begin(), n, h.rank_pos());
+    file.write_array(up_offsets.begin(), n + 1, h.up_offsets_pos());
+    file.write_array(up_edges.begin(), h.m_up, h.up_edges_pos());
+    if (!symmetrized) {
+      file.write_array(down_offsets.begin(), n + 1, h.down_offsets_pos());
+      file.write_array(down_edges.begin(), h.m_down, h.down_edges_pos());
+    }
+    file.write(&h, sizeof(CHHeader), 0);
+    if (!file.publish()) {
+      printf("Warning: cannot write contraction hierarchy %s\n", filename);
+    }
+  }
+};
+
+// Queries on a contraction hierarchy. Every shortest path has a shortest
+// up-down path in the hierarchy, so distance(s, t) runs Dijkstra upward from
+// s and, along the downward edges, upward from t, alternating on the side
+// with the smaller key. It stops once both keys reach mu, the shortest path
+// through a vertex settled by one side and reached by the other. Searches
+// skip the edges of a vertex that is reached at a shorter distance from a
+// higher vertex (stall-on-demand), as it cannot be on a shortest up-down path.
+template <class Graph, class DistTy = typename Graph::EdgeTy>
+class CH_Query {
+  using NodeId = typename Graph::NodeId;
+
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
+
+  using Queue =
+      priority_queue<pair<DistTy, NodeId>, vector<pair<DistTy, NodeId>>,
+                     greater<pair<DistTy, NodeId>>>;
+
+  const ContractionHierarchy<Graph, DistTy> &CH;
+  // forward and backward distances, and the vertices they reached
+  sequence<DistTy> dist[2];
+  vector<NodeId> touched[2];
+
+  // Maps the edges that lead upward from u on side 0 (forward) or 1
+  // (backward)
+  template <class F>
+  void map_upward(int side, NodeId u, F &&f) const {
+    if (side == 0) {
+      CH.map_up(u, f);
+    } else {
+      CH.map_down(u, f);
+    }
+  }
+
+  // Whether a vertex above u reaches it at a shorter distance than d. The
+  // edges into u from above are the edges upward from u on the other side.
+  template <class Dist>
+  bool stalled(int side, NodeId u, DistTy d, Dist &&dist_of) const {
+    bool ret = false;
+    map_upward(1 - side, u, [&](NodeId v, DistTy w) {
+      DistTy dv = dist_of(v);
+      if (dv != DIST_MAX && static_cast<DistTy>(dv + w) < d) {
+        ret = true;
+      }
+    });
+    return ret;
+  }
+
+ public:
+  CH_Query() = delete;
+  CH_Query(const ContractionHierarchy<Graph, DistTy> &_CH) : CH(_CH) {
+    for (int side = 0; side < 2; side++) {
+      dist[side] = sequence<DistTy>(CH.n, DIST_MAX);
+    }
+  }
+
+  // Distance from s to t, DIST_MAX if t is unreachable
+  DistTy distance(NodeId s, NodeId t) {
+    for (int side = 0; side < 2; side++) {
+      for (NodeId v : touched[side]) {
+        dist[side][v] = DIST_MAX;
+      }
+      touched[side].clear();
+    }
+    Queue pq[2];
+    NodeId source[2] = {s, t};
+    for (int side = 0; side < 2; side++) {
+      dist[side][source[side]] = 0;
+      touched[side].push_back(source[side]);
+      pq[side].push(make_pair(0, source[side]));
+    }
+    DistTy mu = DIST_MAX;
+    while (true) {
+      DistTy key[2];
+      for (int side = 0; side < 2; side++) {
+        key[side] = pq[side].empty() ? DIST_MAX : pq[side].top().first;
+      }
+      if (min(key[0], key[1]) >= mu) {
+        break;
+      }
+      int side = key[0] <= key[1] ? 0 : 1;
+      auto [d, u] = pq[side].top();
+      pq[side].pop();
+      if (d > dist[side][u]) {
+        continue;
+      }
+      if (dist[1 - side][u] != DIST_MAX) {
+        mu = min<DistTy>(mu, d + dist[1 - side][u]);
+      }
+      if (stalled(side, u, d, [&](NodeId v) { return dist[side][v]; })) {
+        continue;
+      }
+      map_upward(side, u, [&](NodeId v, DistTy w) {
+        DistTy nd = d + w;
+        if (nd < dist[side][v]) {
+          if (dist[side][v] == DIST_MAX) {
+            touched[side].push_back(v);
+          }
+          dist[side][v] = nd;
+          pq[side].push(make_pair(nd, v));
+        }
+      });
+    }
+    return mu;
+  }
+
+  // The vertices settled and not stalled by an upward search from s on side
+  // 0 (forward) or 1 (backward), with their distances. It keeps its own
+  // distances, so searches run in parallel.
+  sequence<pair<NodeId, DistTy>> search_space(NodeId s, int side) const {
+    LocalDistances<NodeId, DistTy> dist_of;
+    auto dist_at = [&](NodeId v) { return dist_of.get(v); };
+    sequence<pair<NodeId, DistTy>> ret;
+    Queue pq;
+    dist_of.lower(s, 0);
+    pq.push(make_pair(0, s));
+    while (!pq.empty()) {
+      auto [d, u] = pq.top();
+      pq.pop();
+      if (d > dist_at(u) || stalled(side, u, d, dist_at)) {
+        continue;
+      }
+      ret.push_back(make_pair(u, d));
+      map_upward(side, u, [&](NodeId v, DistTy w) {
+        DistTy nd = d + w;
+        if (dist_of.lower(v, nd)) {
+          pq.push(make_pair(nd, v));
+        }
+      });
+    }
+    return ret;
+  }
+
+  // Distances from every source to every target, row by row: the distance
+  // from sources[i] to targets[j] is at i * targets.size() + j. The backward
+  // searches from the targets leave (target, distance) entries in buckets at
+  // the vertices they settle, and the forward search from each source scans
+  // the buckets of its vertices. All searches run in parallel.
+  sequence<DistTy> table(const sequence<NodeId> &sources,
+                         const sequence<NodeId> &targets) const {
+    size_t num_targets = targets.size();
+    auto buckets = flatten(tabulate(
+        num_targets,
+        [&](size_t j) {
+          return parlay::map(search_space(targets[j], 1), [&](const auto &p) {
+            return make_tuple(p.first, j, p.second);
+          });
+        },
+        1));
+    sort_inplace(buckets, [](const auto &a, const auto &b) {
+      return get<0>(a) < get<0>(b);
+    });
+    auto ret = sequence<DistTy>(sources.size() * num_targets, DIST_MAX);
+    parallel_for(
+        0, sources.size(),
+        [&](size_t i) {
+          DistTy *row = ret.data() + i * num_targets;
+          for (auto [u, d] : search_space(sources[i], 0)) {
+            auto it = lower_bound(
+                buckets.begin(), buckets.end(), u,
+                [](const auto &a, NodeId v) { return get<0>(a) < v; });
+            for (; it != buckets.end() && get<0>(*it) == u; it++) {
+              row[get<1>(*it)] =
+                  min<DistTy>(row[get<1>(*it)], d + get<2>(*it));
+            }
+          }
+        },
+        1);
+    return ret;
+  }
+};
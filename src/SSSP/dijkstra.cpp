@@ -7,22 +7,38 @@
 
 typedef uint32_t NodeId;
 typedef uint64_t EdgeId;
+// Distances are as wide as weights unless built with DIST64
 #ifdef FLOAT
 typedef float EdgeTy;
+#ifdef DIST64
+typedef double DistTy;
+#else
+typedef float DistTy;
+#endif
+#else
+#ifdef WEIGHT16
+typedef uint16_t EdgeTy;
 #else
 typedef uint32_t EdgeTy;
 #endif
+#ifdef DIST64
+typedef uint64_t DistTy;
+#else
+typedef uint32_t DistTy;
+#endif
+#endif
 
 constexpr int NUM_SRC = 10;
 constexpr int NUM_ROUND = 1;
-constexpr int LOG2_WEIGHT = 18;
+// random weights must fit in EdgeTy
+constexpr int LOG2_WEIGHT = min<int>(18, sizeof(EdgeTy) * 8 - 1);
 constexpr int WEIGHT_RANGE = 1 << LOG2_WEIGHT;
 
 template <class Algo, class Graph, class NodeId = typename Graph::NodeId>
 void run(Algo &algo, [[maybe_unused]] const Graph &G, NodeId s) {
   printf("source %-10d\n", s);
   double total_time = 0;
-  sequence<EdgeTy> dist;
+  sequence<DistTy> dist;
   for (int i = 0; i <= NUM_ROUND; i++) {
     internal::timer t;
     dist = algo.dijkstra(s);
@@ -94,7 +110,7 @@ int main(int argc, char *argv[]) {
   fprintf(stdout, "Running on %s: |V|=%zu, |E|=%zu, num_src=%d, num_round=%d\n",
           input_path, G.n, G.m, NUM_SRC, NUM_ROUND);
 
-  Dijkstra solver(G);
+  Dijkstra<decltype(G), DistTy> solver(G);
   if (source == UINT_MAX) {
     run(solver, G);
   } else {
@@ -0,0 +1,76 @@
+#pragma once
+#include <climits>
+
+#include "graph.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+
+using namespace std;
+using namespace parlay;
+
+// Checks a shortest-path tree from s against distances known to be correct:
+//  1. parent[s] == s
+//  2. the vertices with a parent are the vertices reached by the search
+//  3. every tree edge (parent[v], v) is an edge of the graph with
+//     dist[parent[v]] + w == dist[v]
+// With positive weights, 3 makes distances decrease strictly along parents,
+// so the parents lead to s without cycles. Unreached vertices have parent
+// NODE_MAX. Rule 3 scans the out-edges of every reached vertex once, so
+// directed graphs need no in-CSR. Prints the rules that are violated and returns whether all
+// of them hold.
+template <class Graph, class DistTy, class NodeId = typename Graph::NodeId>
+bool validate_sssp_tree(const Graph &G, NodeId s,
+                        const sequence<NodeId> &parent,
+                        const sequence<DistTy> &dist) {
+  constexpr NodeId NODE_MAX = numeric_limits<NodeId>::max();
+  constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
+  size_t n = G.n;
+  auto count = [&](auto &&f) {
+    return reduce(delayed_seq<size_t>(n, [&](NodeId v) -> size_t {
+      return f(v) ? 1 : 0;
+    }));
+  };
+  bool valid = true;
+  auto check = [&](size_t violations, const char *rule) {
+    if (violations) {
+      printf("Validation failed: %zu vertices violate: %s\n", violations, rule);
+      valid = false;
+    }
+  };
+
+  // Rule 1
+  if (parent[s] != s || dist[s] != 0) {
+    printf("Validation failed: source %zu is not the root\n", (size_t)s);
+    return false;
+  }
+
+  // Rule 2
+  check(count([&](NodeId v) {
+          return (parent[v] == NODE_MAX) != (dist[v] == DIST_MAX);
+        }),
+        "parent differs from reachability");
+
+  // Rule 3: every parent p scans its out-edges once and marks the children
+  // v it reaches by a tight edge with parent[v] == p, in O(m) work
+  constexpr size_t BLOCK_SIZE = 1024;
+  auto tree_edge = sequence<bool>(n, false);
+  parallel_for(0, n, [&](NodeId p) {
+    if (dist[p] == DIST_MAX) {
+      return;
+    }
+    G.map_neighbors_parallel(
+        p,
+        [&](NodeId v, auto w) {
+          if (parent[v] == p &&
+              static_cast<DistTy>(dist[p] + w) == dist[v]) {
+            tree_edge[v] = true;
+          }
+        },
+        BLOCK_SIZE);
+  });
+  check(count([&](NodeId v) {
+          return v != s && parent[v] != NODE_MAX && !tree_edge[v];
+        }),
+        "tree edge is not a tight edge of the graph");
+  return valid;
+}
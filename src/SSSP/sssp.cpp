@@ -3,25 +3,54 @@
 #include <queue>
 #include <type_traits>
 
+#include "alt.h"
+#include "bidirectional-sssp.h"
+#include "compressed_graph.h"
 #include "dijkstra.h"
 #include "graph.h"
+#include "reorder.h"
+#include "sssp-validator.h"
 
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
 typedef uint32_t NodeId;
+#endif
 typedef uint64_t EdgeId;
+// Distances are as wide as weights unless built with DIST64
 #ifdef FLOAT
 typedef float EdgeTy;
+#ifdef DIST64
+typedef double DistTy;
+#else
+typedef float DistTy;
+#endif
+#else
+#ifdef WEIGHT16
+typedef uint16_t EdgeTy;
 #else
 typedef uint32_t EdgeTy;
 #endif
+#ifdef DIST64
+typedef uint64_t DistTy;
+#else
+typedef uint32_t DistTy;
+#endif
+#endif
+constexpr NodeId NO_SOURCE = numeric_limits<NodeId>::max();
 constexpr int NUM_SRC = 10;
 constexpr int NUM_ROUND = 5;
-constexpr int LOG2_WEIGHT = 18;
+// random weights must fit in EdgeTy
+constexpr int LOG2_WEIGHT = min<int>(18, sizeof(EdgeTy) * 8 - 1);
 constexpr int WEIGHT_RANGE = 1 << LOG2_WEIGHT;
 
-template <class Algo, class Graph, class NodeId = typename Graph::NodeId>
-void run(Algo &algo, [[maybe_unused]] const Graph &G, NodeId s, bool verify, bool dump) {
+// With tree, also times the searches that compute shortest-path parents and
+// reports their overhead.
+template <class Algo, class Graph>
+double run(Algo &algo, [[maybe_unused]] const Graph &G, NodeId s, bool verify,
+           bool tree, bool dump, const sequence<NodeId> &rank) {
   double total_time = 0;
-  sequence<EdgeTy> dist;
+  sequence<DistTy> dist;
   for (int i = 0; i <= NUM_ROUND; i++) {
     internal::timer t;
     dist = algo.sssp(s);
@@ -36,18 +65,56 @@ void run(Algo &algo, [[maybe_unused]] const Graph &G, NodeId s, bool verify, boo
   double average_time = total_time / NUM_ROUND;
   printf("Average time: %f\n", average_time);
 
+  sequence<NodeId> parent;
+  if (tree) {
+    double tree_time = 0;
+    for (int i = 1; i <= NUM_ROUND; i++) {
+      internal::timer t;
+      tie(dist, parent) = algo.sssp_tree(s);
+      t.stop();
+      printf("Tree Round %d: %f\n", i, t.total_time());
+      tree_time += t.total_time();
+    }
+    tree_time /= NUM_ROUND;
+    printf("Average tree time: %f (overhead: %.1f%%)\n", tree_time,
+           (tree_time / average_time - 1) * 100);
+  }
+
   ofstream ofs("sssp.tsv", ios_base::app);
   ofs << s << '\t' << average_time << '\n';
   ofs.close();
 
   if (verify) {
     printf("Running verifier...\n");
-    Dijkstra verifier(G);
+    Dijkstra<Graph, DistTy> verifier(G);
     auto exp_dist = verifier.dijkstra(s);
     assert(dist == exp_dist);
+    if (tree) {
+      if (!validate_sssp_tree(G, s, parent, dist)) {
+        abort();
+      }
+      // the path to the farthest reached vertex follows the parents
+      auto reached_dist = delayed_seq<DistTy>(G.n, [&](size_t v) {
+        return dist[v] == numeric_limits<DistTy>::max() ? 0 : dist[v];
+      });
+      NodeId t = max_element(reached_dist) - reached_dist.begin();
+      if (dist[t] == numeric_limits<DistTy>::max()) {
+        // s reaches no other vertex
+        t = s;
+      }
+      auto path = algo.path(t);
+      assert(path.size() && path[0] == s && path[path.size() - 1] == t);
+      for (size_t i = 1; i < path.size(); i++) {
+        assert(parent[path[i]] == path[i - 1]);
+      }
+    }
     printf("Passed!\n");
   }
   if (dump) {
+    // Distances are dumped by original vertex ids
+    if (!rank.empty()) {
+      dist = map_back(dist, rank);
+    }
     ofstream ofs("sssp.out");
     for (size_t i = 0; i < dist.size(); i++) {
       ofs << dist[i] << '\n';
@@ -55,14 +122,185 @@ void run(Algo &algo, [[maybe_unused]] const Graph &G, NodeId s, bool verify, boo
     ofs.close();
   }
   printf("\n");
+  return average_time;
 }
 
-template <class Algo, class Graph>
-void run(Algo &algo, const Graph &G, bool verify, bool dump) {
-  for (int v = 0; v < NUM_SRC; v++) {
-    uint32_t s = hash32(v) % G.n;
-    printf("source %d: %-10d\n", v, s);
-    run(algo, G, s, verify, dump);
+// Times the s-t searches of algo, which stop once t is settled, of the
+// bidirectional search bi, and of the goal-directed search alt if it has
+// landmarks, and returns the average time of the first
+template <class Algo, class Bidirectional, class Goal, class Graph>
+double run_query(Algo &algo, Bidirectional &bi, Goal &alt, size_t landmarks,
+                 [[maybe_unused]] const Graph &G, NodeId s, NodeId t,
+                 bool verify) {
+  DistTy d = 0, bi_d = 0, alt_d = 0;
+  auto time_rounds = [&](auto &&query) {
+    double total_time = 0;
+    for (int i = 0; i <= NUM_ROUND; i++) {
+      internal::timer tm;
+      query();
+      tm.stop();
+      if (i == 0) {
+        printf("Warmup Round: %f\n", tm.total_time());
+      } else {
+        printf("Round %d: %f\n", i, tm.total_time());
+        total_time += tm.total_time();
+      }
+    }
+    return total_time / NUM_ROUND;
+  };
+  double average_time = time_rounds([&] { d = algo.distance(s, t); });
+  printf("Average time: %f\n", average_time);
+  double bi_time = time_rounds([&] { bi_d = bi.distance(s, t); });
+  printf("Average bidirectional time: %f\n", bi_time);
+  double alt_time = 0;
+  if (landmarks) {
+    alt_time = time_rounds([&] { alt_d = alt.distance(s, t); });
+    printf("Average ALT time: %f\n", alt_time);
+    printf("Reached vertices: %zu, with ALT: %zu\n", algo.num_reached(),
+           alt.num_reached());
+  } else {
+    alt_d = d;
+  }
+  if (d == numeric_limits<DistTy>::max()) {
+    printf("Distance: unreachable\n");
+  } else {
+    cout << "Distance: " << d << endl;
+  }
+
+  ofstream ofs("sssp.tsv", ios_base::app);
+  ofs << s << '\t' << t << '\t' << average_time << '\t' << bi_time;
+  if (landmarks) {
+    ofs << '\t' << alt_time;
+  }
+  ofs << '\n';
+  ofs.close();
+
+  if (verify) {
+    printf("Running verifier...\n");
+    Dijkstra<Graph, DistTy> verifier(G);
+    DistTy exp_d = verifier.dijkstra(s)[t];
+    assert(d == exp_d && bi_d == exp_d && alt_d == exp_d);
+    printf("Passed!\n");
+  }
+  printf("\n");
+  return average_time;
+}
+
+// Runs from source, or from NUM_SRC random sources if source is NO_SOURCE, and
+// returns the average time. Sources are original ids, renamed by rank if G is
+// a relabeled graph. With a target, times s-t searches instead, also directed
+// by num_landmarks landmarks if it is nonzero. Sparse rounds prefetch
+// prefetch_distance vertices ahead.
+template <class Graph>
+double run(const Graph &G, int algorithm, const string &parameter,
+           NodeId source, NodeId target, size_t num_landmarks, bool verify,
+           bool tree, bool dump, size_t prefetch_distance,
+           const sequence<NodeId> &rank) {
+  auto run_sources = [&](auto &solver) {
+    solver.set_prefetch_distance(prefetch_distance);
+    if (source != NO_SOURCE) {
+      return run(solver, G, rank.empty() ? source : rank[source], verify,
+                 tree, dump, rank);
+    }
+    double total_time = 0;
+    for (int v = 0; v < NUM_SRC; v++) {
+      NodeId s = hash32(v) % G.n;
+      printf("source %d: %-10zu\n", v, static_cast<size_t>(s));
+      total_time += run(solver, G, rank.empty() ? s : rank[s], verify, tree,
+                        dump, rank);
+    }
+    return total_time / NUM_SRC;
+  };
+  auto run_targets = [&](auto &solver, auto &bi, auto &alt) {
+    solver.set_prefetch_distance(prefetch_distance);
+    bi.set_prefetch_distance(prefetch_distance);
+    alt.set_prefetch_distance(prefetch_distance);
+    NodeId t = rank.empty() ? target : rank[target];
+    if (source != NO_SOURCE) {
+      NodeId s = rank.empty() ? source : rank[source];
+      printf("source %-10zu target %-10zu\n", static_cast<size_t>(s),
+             static_cast<size_t>(t));
+      return run_query(solver, bi, alt, num_landmarks, G, s, t, verify);
+    }
+    double total_time = 0;
+    for (int v = 0; v < NUM_SRC; v++) {
+      NodeId s = hash32(v) % G.n;
+      printf("source %d: %-10zu target %-10zu\n", v, static_cast<size_t>(s),
+             static_cast<size_t>(target));
+      total_time += run_query(solver, bi, alt, num_landmarks, G,
+                              rank.empty() ? s : rank[s], t, verify);
+    }
+    return total_time / NUM_SRC;
+  };
+  if (target != NO_SOURCE && num_landmarks) {
+    printf("Choosing %zu landmarks...\n", num_landmarks);
+  }
+  internal::timer landmark_timer;
+  Landmarks<Graph, DistTy> landmarks(
+      G, target != NO_SOURCE ? num_landmarks : 0);
+  landmark_timer.stop();
+  if (landmarks.size()) {
+    printf("Landmark time: %f\n", landmark_timer.total_time());
+  }
+  if (algorithm == rho_stepping) {
+    size_t rho = 1 << 20;
+    if (!parameter.empty()) {
+      rho = stoull(parameter);
+    }
+    Rho_Stepping<Graph, DistTy> solver(G, rho);
+    if (target != NO_SOURCE) {
+      Bidirectional_SSSP<Graph, DistTy, Rho_Stepping> bi(G, rho);
+      ALT<Graph, DistTy, Rho_Stepping> alt(G, landmarks, rho);
+      return run_targets(solver, bi, alt);
+    }
+    return run_sources(solver);
+  } else if (algorithm == delta_stepping) {
+    DistTy delta = 1 << 15;
+    if (!parameter.empty()) {
+      if constexpr (is_integral_v<DistTy>) {
+        delta = stoull(parameter);
+      } else {
+        delta = stod(parameter);
+      }
+    }
+    Delta_Stepping<Graph, DistTy> solver(G, delta);
+    if (target != NO_SOURCE) {
+      Bidirectional_SSSP<Graph, DistTy, Delta_Stepping> bi(G, delta);
+      ALT<Graph, DistTy, Delta_Stepping> alt(G, landmarks, delta);
+      return run_targets(solver, bi, alt);
+    }
+    return run_sources(solver);
+  } else {
+    Bellman_Ford<Graph, DistTy> solver(G);
+    if (target != NO_SOURCE) {
+      Bidirectional_SSSP<Graph, DistTy, Bellman_Ford> bi(G);
+      ALT<Graph, DistTy, Bellman_Ford> alt(G, landmarks);
+      return run_targets(solver, bi, alt);
+    }
+    return run_sources(solver);
+  }
+}
+
+template <class Graph>
+double run(Graph &G, bool compressed, int algorithm, const string &parameter,
+           NodeId source, NodeId target, size_t num_landmarks, bool verify,
+           bool tree, bool dump, size_t prefetch_distance,
+           const sequence<NodeId> &rank) {
+  if (compressed) {
+    printf("Compressing graph...\n");
+    internal::timer t;
+    CompressedGraph CG(G);
+    t.stop();
+    size_t original_size = G.offsets.size() * sizeof(EdgeId) +
+                           G.edges.size() * sizeof(G.edges[0]);
+    printf("Compressed %zu bytes to %zu bytes in %f seconds\n", original_size,
+           CG.size_in_bytes(), t.total_time());
+    G = Graph();
+    return run(CG, algorithm, parameter, source, target, num_landmarks,
+               verify, tree, dump, prefetch_distance, rank);
+  } else {
+    return run(G, algorithm, parameter, source, target, num_landmarks, verify,
+               tree, dump, prefetch_distance, rank);
   }
 }
 
@@ -70,26 +308,45 @@ int main(int argc, char *argv[]) {
   if (argc == 1) {
     fprintf(stderr,
             "Usage: %s [-i input_file] [-a algorithm] [-p parameter] [-s] [-v] "
-            "[-d]\n"
+            "[-t] [-d] [-c] [-o ordering] [-f distance] [-r source] "
+            "[-q target] [-l landmarks]\n"
             "Options:\n"
             "\t-i,\tinput file path\n"
             "\t-a,\talgorithm: [rho-stepping] [delta-stepping] [bellman-ford]\n"
             "\t-p,\tparameter(e.g. delta, rho)\n"
             "\t-s,\tsymmetrized input graph\n"
             "\t-v,\tverify result\n"
-            "\t-d,\tdump distances to file\n",
-            argv[0]);
+            "\t-t,\talso time the search for shortest-path parents, and "
+            "validate them with -v\n"
+            "\t-d,\tdump distances to file\n"
+            "\t-c,\trun on the compressed graph\n"
+            "\t-o,\talso run after reordering vertices: [degree] [hub] "
+            "[bfs] [rcm] [gorder] [ldd]\n"
+            "\t-f,\tprefetch distance of sparse rounds, 0 to disable "
+            "(default: %zu)\n"
+            "\t-r,\tsource vertex (default: 10 random sources)\n"
+            "\t-q,\ttime searches from the sources that stop at target, "
+            "one-way and bidirectional\n"
+            "\t-l,\twith -q, also time searches directed by this many "
+            "landmarks (ALT)\n",
+            argv[0], PREFETCH_DISTANCE);
     return 0;
   }
   char c;
   char const *input_path = nullptr;
   int algorithm = rho_stepping;
   string parameter;
-  uint32_t source = UINT_MAX;
+  NodeId source = NO_SOURCE;
+  NodeId target = NO_SOURCE;
+  size_t num_landmarks = 0;
   bool symmetrized = false;
   bool verify = false;
+  bool tree = false;
   bool dump = false;
-  while ((c = getopt(argc, argv, "i:a:p:r:svd")) != -1) {
+  bool compressed = false;
+  char const *ordering = nullptr;
+  size_t prefetch_distance = PREFETCH_DISTANCE;
+  while ((c = getopt(argc, argv, "i:a:p:r:q:l:svtdco:f:")) != -1) {
     switch (c) {
       case 'i':
         input_path = optarg;
@@ -112,15 +369,33 @@ int main(int argc, char *argv[]) {
       case 'r':
         source = atol(optarg);
         break;
+      case 'q':
+        target = atol(optarg);
+        break;
+      case 'l':
+        num_landmarks = atol(optarg);
+        break;
       case 's':
         symmetrized = true;
         break;
       case 'v':
         verify = true;
         break;
+      case 't':
+        tree = true;
+        break;
       case 'd':
         dump = true;
         break;
+      case 'c':
+        compressed = true;
+        break;
+      case 'o':
+        ordering = optarg;
+        break;
+      case 'f':
+        prefetch_distance = atol(optarg);
+        break;
       default:
         std::cerr << "Error: Unknown option " << optopt << std::endl;
         abort();
@@ -143,40 +418,40 @@ int main(int argc, char *argv[]) {
   fprintf(stdout, "Running on %s: |V|=%zu, |E|=%zu, num_src=%d, num_round=%d\n",
           input_path, G.n, G.m, NUM_SRC, NUM_ROUND);
 
-  if (algorithm == rho_stepping) {
-    size_t rho = 1 << 20;
-    if (!parameter.empty()) {
-      Rho_Stepping solver(G);
-      rho = stoull(parameter);
-    }
-    Rho_Stepping solver(G, rho);
-    if (source == UINT_MAX) {
-      run(solver, G, verify, dump);
+  // followed in both directions by the bfs, rcm, gorder and ldd orderings,
+  // and backward by bidirectional searches
+  if (!G.symmetrized && (ordering || target != NO_SOURCE)) {
+    if (!strcmp(input_path, "random")) {
+      G.make_inverse();
     } else {
-      run(solver, G, source, verify, dump);
+      G.make_inverse(input_path);
     }
-  } else if (algorithm == delta_stepping) {
-    EdgeTy delta = 1 << 15;
-    if (!parameter.empty()) {
-      if constexpr (is_integral_v<EdgeTy>) {
-        delta = stoull(parameter);
-      } else {
-        delta = stod(parameter);
-      }
-    }
-    Delta_Stepping solver(G, delta);
-    if (source == UINT_MAX) {
-      run(solver, G, verify, dump);
-    } else {
-      run(solver, G, source, verify, dump);
-    }
-  } else if (algorithm == bellman_ford) {
-    Bellman_Ford solver(G);
-    if (source == UINT_MAX) {
-      run(solver, G, verify, dump);
-    } else {
-      run(solver, G, source, verify, dump);
+  }
+
+  sequence<NodeId> rank;
+  Graph<NodeId, EdgeId, EdgeTy> RG;
+  if (ordering) {
+    printf("Reordering graph (%s)...\n", ordering);
+    internal::timer t;
+    rank = reorder(G, parse_ordering(ordering));
+    RG = relabel(G, rank);
+    if (target != NO_SOURCE && !RG.symmetrized) {
+      RG.make_inverse();
     }
+    t.stop();
+    printf("Reordering time: %f\n", t.total_time());
+  }
+
+  double average_time =
+      run(G, compressed, algorithm, parameter, source, target, num_landmarks,
+          verify, tree, dump, prefetch_distance, {});
+  if (ordering) {
+    printf("Running on the reordered graph...\n");
+    double reordered_time =
+        run(RG, compressed, algorithm, parameter, source, target,
+            num_landmarks, verify, tree, dump, prefetch_distance, rank);
+    printf("Average time before reordering: %f, after reordering (%s): %f\n",
+           average_time, ordering, reordered_time);
   }
   return 0;
 }
@@ -6,6 +6,7 @@
 #include "parlay/parallel.h"
 #include "parlay/sequence.h"
 #include "parlay/utilities.h"
+#include "prefetch.h"
 #include "utils.h"
 
 using namespace std;
@@ -13,31 +14,70 @@ using namespace parlay;
 
 enum Algorithm { rho_stepping = 0, delta_stepping, bellman_ford };
 
-template <class Graph>
+// Distances are of type DistTy, which defaults to the weight type. A wider
+// DistTy lets graphs store narrow weights (e.g. uint16_t) without overflowing
+// the distances of long paths.
+template <class Graph, class DistTy = typename Graph::EdgeTy>
 class SSSP {
  protected:
   using NodeId = typename Graph::NodeId;
   using EdgeId = typename Graph::EdgeId;
   using EdgeTy = typename Graph::EdgeTy;
 
-  static constexpr EdgeTy DIST_MAX = numeric_limits<EdgeTy>::max();
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
+  static constexpr NodeId NODE_MAX = numeric_limits<NodeId>::max();
   static constexpr size_t LOCAL_QUEUE_SIZE = 128;
   static constexpr size_t BLOCK_SIZE = 1024;
   static constexpr size_t NUM_SAMPLES = 1024;
   static constexpr size_t SPARSE_TH = 100;
   static constexpr size_t GROWTH_FACTOR = 10;
+  static constexpr size_t RESET_TH = 20;
 
   const Graph &G;
   bool sparse;
   size_t frontier_size;
   hashbag<NodeId> bag;
-  sequence<EdgeTy> dist;
+  sequence<DistTy> dist;
   sequence<NodeId> frontier;
   sequence<atomic<bool>> in_frontier;
   sequence<atomic<bool>> in_next_frontier;
+  // the vertices reached by the last search are visited[0, num_visited). They
+  // are collected in touched while searching, but only once a caller needs
+  // them (see track_visited). Until then searches set num_visited to n, so
+  // that the next search resets the whole graph.
+  bool tracking;
+  hashbag<NodeId> touched;
+  sequence<NodeId> visited;
+  size_t num_visited;
+  // allocated by the first sssp_tree
+  sequence<NodeId> parent;
+  // set by Bidirectional_SSSP: the distances of the other side, and the
+  // length of the shortest path through a vertex reached by both sides
+  const DistTy *other_dist;
+  DistTy *meet_dist;
+  // set by goal-directed searches (see alt.h): a lower bound on the distance
+  // from each vertex to the target, filled in when the vertex is first
+  // ordered. Empty for plain searches.
+  sequence<DistTy> potential;
+  // sparse rounds prefetch the neighbors of the frontier this many vertices
+  // ahead (see prefetch.h)
+  size_t prefetch_distance;
 
   virtual void init() = 0;
-  virtual EdgeTy get_threshold() = 0;
+  virtual DistTy get_threshold() = 0;
+  virtual DistTy compute_potential(NodeId) { return 0; }
+
+  // The frontier is ordered by dist[v] plus the potential of v. Only reached
+  // vertices have keys.
+  DistTy key(NodeId v) {
+    if (potential.empty()) {
+      return dist[v];
+    }
+    if (potential[v] == DIST_MAX) {
+      potential[v] = compute_potential(v);
+    }
+    return dist[v] + potential[v];
+  }
 
   void add_to_frontier(NodeId v) {
     if (sparse) {
@@ -52,6 +92,35 @@ class SSSP {
     }
   }
 
+  // Called when dist[v] was lowered to d
+  void lowered(NodeId v, DistTy d) {
+    if (other_dist && other_dist[v] != DIST_MAX) {
+      write_min(meet_dist, static_cast<DistTy>(d + other_dist[v]));
+    }
+  }
+
+  // Lowers dist[v] to d, and records v as reached if it was not
+  bool relax(NodeId v, DistTy d) {
+    DistTy old = fetch_and_min(&dist[v], d);
+    if (d >= old) {
+      return false;
+    }
+    if (old == DIST_MAX && tracking) {
+      touched.insert(v);
+    }
+    lowered(v, d);
+    return true;
+  }
+
+  // Collects the visited vertices from the next search on
+  void track_visited() {
+    if (!tracking) {
+      tracking = true;
+      touched.reserve(G.n);
+      visited = sequence<NodeId>::uninitialized(G.n);
+    }
+  }
+
   size_t estimate_size() {
     static uint32_t seed = G.n;
     size_t hits = 0;
@@ -68,65 +137,58 @@ class SSSP {
   inline void visit_neighbors_sequential(NodeId u, NodeId *local_queue,
                                          size_t &rear) {
     if (G.symmetrized) {
-      EdgeTy min_dist = dist[u];
-      for (EdgeId i = G.offsets[u]; i < G.offsets[u + 1]; i++) {
-        NodeId v = G.edges[i].v;
-        EdgeTy w = G.edges[i].w;
+      DistTy min_dist = dist[u];
+      G.map_neighbors(u, [&](NodeId v, EdgeTy w) {
         if (dist[v] != DIST_MAX) {
-          min_dist = min(min_dist, dist[v] + w);
+          min_dist = min<DistTy>(min_dist, dist[v] + w);
         }
+      });
+      if (write_min(&dist[u], min_dist)) {
+        lowered(u, min_dist);
       }
-      write_min(&dist[u], min_dist);
     }
-    for (EdgeId i = G.offsets[u]; i < G.offsets[u + 1]; i++) {
-      NodeId v = G.edges[i].v;
-      EdgeTy w = G.edges[i].w;
-      if (write_min(&dist[v], dist[u] + w)) {
+    G.map_neighbors(u, [&](NodeId v, EdgeTy w) {
+      if (relax(v, dist[u] + w)) {
         if (rear < LOCAL_QUEUE_SIZE) {
           local_queue[rear++] = v;
         } else {
           add_to_frontier(v);
         }
       }
-    }
+    });
   }
 
   inline void visit_neighbors_parallel(NodeId u) {
-    blocked_for(G.offsets[u], G.offsets[u + 1], BLOCK_SIZE,
-                [&](size_t, size_t start, size_t end) {
-                  if (G.symmetrized) {
-                    EdgeTy min_dist = dist[u];
-                    for (EdgeId i = start; i < end; i++) {
-                      NodeId v = G.edges[i].v;
-                      EdgeTy w = G.edges[i].w;
-                      if (dist[v] != DIST_MAX) {
-                        min_dist = min(min_dist, dist[v] + w);
-                      }
-                    }
-                    if (write_min(&dist[u], min_dist)) {
-                      add_to_frontier(u);
-                    }
-                  }
-                  for (EdgeId i = start; i < end; i++) {
-                    NodeId v = G.edges[i].v;
-                    EdgeTy w = G.edges[i].w;
-                    if (write_min(&dist[v], dist[u] + w)) {
-                      add_to_frontier(v);
-                    }
-                  }
-                });
+    G.map_neighbor_blocks(u, BLOCK_SIZE, [&](auto &&map_block) {
+      if (G.symmetrized) {
+        DistTy min_dist = dist[u];
+        map_block([&](NodeId v, EdgeTy w) {
+          if (dist[v] != DIST_MAX) {
+            min_dist = min<DistTy>(min_dist, dist[v] + w);
+          }
+        });
+        if (write_min(&dist[u], min_dist)) {
+          lowered(u, min_dist);
+          add_to_frontier(u);
+        }
+      }
+      map_block([&](NodeId v, EdgeTy w) {
+        if (relax(v, dist[u] + w)) {
+          add_to_frontier(v);
+        }
+      });
+    });
   }
 
   size_t sparse_relax() {
     constexpr bool use_local_queue = true;
 
-    EdgeTy threshold = get_threshold();
-    parallel_for(
-        0, frontier_size,
-        [&](size_t i) {
-          NodeId f = frontier[i];
+    DistTy threshold = get_threshold();
+    for_each_prefetched(
+        G, frontier, frontier_size, dist.data(), prefetch_distance,
+        [&](NodeId f) {
           in_frontier[f] = false;
-          if (dist[f] > threshold) {
+          if (key(f) > threshold) {
             add_to_frontier(f);
           } else {
             if (use_local_queue) {
@@ -135,11 +197,11 @@ class SSSP {
               local_queue[rear++] = f;
               while (front < rear) {
                 NodeId u = local_queue[front++];
-                if (dist[u] > threshold) {
+                if (key(u) > threshold) {
                   add_to_frontier(u);
                   continue;
                 }
-                size_t deg = G.offsets[u + 1] - G.offsets[u];
+                size_t deg = G.degree(u);
                 if (deg < 10 * BLOCK_SIZE) {
                   visit_neighbors_sequential(u, local_queue, rear);
                 } else {
@@ -158,13 +220,13 @@ class SSSP {
 
   size_t dense_relax() {
     while (estimate_size() >= G.n / SPARSE_TH) {
-      EdgeTy threshold = get_threshold();
+      DistTy threshold = get_threshold();
       parallel_for(
           0, G.n,
           [&](NodeId u) {
             if (in_frontier[u]) {
               in_frontier[u] = false;
-              if (dist[u] > threshold) {
+              if (key(u) > threshold) {
                 add_to_frontier(u);
               } else {
                 visit_neighbors_parallel(u);
@@ -184,95 +246,283 @@ class SSSP {
     pack_into_uninitialized(identity, in_frontier, frontier);
   }
 
- public:
-  SSSP() = delete;
-  SSSP(const Graph &_G) : G(_G), bag(G.n) {
-    dist = sequence<EdgeTy>::uninitialized(G.n);
-    frontier = sequence<NodeId>::uninitialized(G.n);
-    in_frontier = sequence<atomic<bool>>::uninitialized(G.n);
-    in_next_frontier = sequence<atomic<bool>>::uninitialized(G.n);
+  // Undoes the last search, touching only the vertices it reached unless
+  // they are a large part of the graph
+  void reset() {
+    auto clear = [&](NodeId v) {
+      dist[v] = DIST_MAX;
+      in_frontier[v] = in_next_frontier[v] = false;
+      if (!parent.empty()) {
+        parent[v] = NODE_MAX;
+      }
+      if (!potential.empty()) {
+        potential[v] = DIST_MAX;
+      }
+    };
+    if (num_visited * RESET_TH >= G.n) {
+      parallel_for(0, G.n, [&](NodeId i) { clear(i); });
+    } else {
+      parallel_for(0, num_visited, [&](size_t i) { clear(visited[i]); });
+    }
+    num_visited = 0;
   }
 
-  sequence<EdgeTy> sssp(NodeId s) {
+  // A search is start(s), rounds of step() until the frontier is empty, and
+  // finish()
+  void start(NodeId s) {
     if (!G.weighted) {
       fprintf(stderr, "Error: Input graph is unweighted\n");
       exit(EXIT_FAILURE);
     }
 
     init();
-    parallel_for(0, G.n, [&](NodeId i) {
-      dist[i] = DIST_MAX;
-      in_frontier[i] = in_next_frontier[i] = false;
-    });
+    reset();
     assert(bag.pack_into(make_slice(frontier)) == 0);
 
     frontier_size = 1;
     dist[s] = 0;
+    if (tracking) {
+      touched.insert(s);
+    }
     frontier[0] = s;
     in_frontier[s] = true;
     sparse = true;
+  }
 
-    // int round = 0;
+  void step() {
+    // printf("%s, size: %zu, ", sparse ? "sparse" : "dense", frontier_size);
+    // internal::timer t;
+    if (sparse) {
+      frontier_size = sparse_relax();
+    } else {
+      frontier_size = dense_relax();
+    }
+    // printf("relax: %f, ", t.next_time());
+    bool next_sparse = (frontier_size < G.n / SPARSE_TH) ? true : false;
+    if (sparse && !next_sparse) {
+      sparse2dense();
+    } else if (!sparse && next_sparse) {
+      dense2sparse();
+    }
+    // printf("pack: %f\n", t.next_time());
+    sparse = next_sparse;
+  }
+
+  void finish() {
+    num_visited = tracking ? touched.pack_into(make_slice(visited)) : G.n;
+  }
+
+  void search(NodeId s) {
+    start(s);
     while (frontier_size) {
-      // printf("Round %d: %s, size: %zu, ", round++, sparse ? "sparse" :
-      // "dense", frontier_size);
-      // internal::timer t;
-      if (sparse) {
-        frontier_size = sparse_relax();
-      } else {
-        frontier_size = dense_relax();
+      step();
+    }
+    finish();
+  }
+
+  // Smallest key in the frontier, DIST_MAX if it is empty. Between rounds,
+  // every vertex outside the frontier has relaxed its out-edges with its
+  // current distance, so with nonnegative weights no distance below this
+  // bound can still change. With potentials that never overestimate, no path
+  // to the target shorter than the bound is still unfound.
+  DistTy frontier_min() {
+    if (sparse) {
+      return reduce(delayed_seq<DistTy>(frontier_size,
+                                        [&](size_t i) {
+                                          return key(frontier[i]);
+                                        }),
+                    minm<DistTy>());
+    }
+    return reduce(delayed_seq<DistTy>(G.n,
+                                      [&](NodeId v) {
+                                        return in_frontier[v] ? key(v)
+                                                              : DIST_MAX;
+                                      }),
+                  minm<DistTy>());
+  }
+
+  // Relaxations lower distances with write_min and may race, so parents are
+  // found after the search instead: every reached vertex v != s takes a u with
+  // a tight edge, dist[u] + w(u, v) == dist[v]. Symmetrized graphs pull from
+  // the in-edges of v and stop at the first tight one. Other graphs push along
+  // the out-edges of the reached vertices, keeping the smallest u, so they
+  // need no transpose. Tight edges point from smaller to larger distances as
+  // weights are positive (checked by sssp_tree), so the parents form a tree.
+  // Zero-weight cycles would have tight edges both ways.
+  void find_parents(NodeId s) {
+    auto tight = [&](NodeId u, NodeId v, EdgeTy w) {
+      return dist[u] != DIST_MAX &&
+             dist[v] == static_cast<DistTy>(dist[u] + w);
+    };
+    if (G.symmetrized) {
+      parallel_for(0, num_visited, [&](size_t i) {
+        NodeId v = visited[i];
+        if (v != s) {
+          G.map_in_neighbors_until(v, [&](NodeId u, EdgeTy w) {
+            if (tight(u, v, w)) {
+              parent[v] = u;
+              return true;
+            }
+            return false;
+          });
+        }
+      });
+    } else {
+      parallel_for(0, num_visited, [&](size_t i) {
+        NodeId u = visited[i];
+        G.map_neighbors_parallel(
+            u,
+            [&](NodeId v, EdgeTy w) {
+              if (v != s && tight(u, v, w)) {
+                write_min(&parent[v], u);
+              }
+            },
+            BLOCK_SIZE);
+      });
+    }
+    parent[s] = s;
+  }
+
+ public:
+  SSSP() = delete;
+  SSSP(const Graph &_G)
+      : G(_G), bag(G.n), tracking(false), touched(G.n, 0.5, NODE_MAX, 0) {
+    dist = sequence<DistTy>(G.n, DIST_MAX);
+    frontier = sequence<NodeId>::uninitialized(G.n);
+    in_frontier = sequence<atomic<bool>>(G.n);
+    in_next_frontier = sequence<atomic<bool>>(G.n);
+    num_visited = 0;
+    other_dist = nullptr;
+    meet_dist = nullptr;
+    prefetch_distance = PREFETCH_DISTANCE;
+  }
+
+  // 0 turns the prefetching of sparse rounds off
+  void set_prefetch_distance(size_t d) { prefetch_distance = d; }
+
+  sequence<DistTy> sssp(NodeId s) {
+    search(s);
+    return dist;
+  }
+
+  // Distances and shortest-path parents from s, for positive weights. The
+  // parent of s is s, and the parent of an unreachable vertex is NODE_MAX.
+  // The first call checks the weights.
+  tuple<sequence<DistTy>, sequence<NodeId>> sssp_tree(NodeId s) {
+    if (parent.empty()) {
+      size_t nonpositive = reduce(delayed_seq<size_t>(G.n, [&](NodeId u) {
+        size_t count = 0;
+        G.map_neighbors(u, [&](NodeId, EdgeTy w) { count += !(w > 0); });
+        return count;
+      }));
+      if (nonpositive) {
+        std::cerr << "Error: sssp_tree needs positive weights, but "
+                  << nonpositive << " edges have weight zero or less"
+                  << std::endl;
+        abort();
       }
-      // printf("relax: %f, ", t.next_time());
-      bool next_sparse = (frontier_size < G.n / SPARSE_TH) ? true : false;
-      if (sparse && !next_sparse) {
-        sparse2dense();
-      } else if (!sparse && next_sparse) {
-        dense2sparse();
+      parent = sequence<NodeId>(G.n, NODE_MAX);
+    }
+    track_visited();
+    search(s);
+    find_parents(s);
+    return {dist, parent};
+  }
+
+  // Vertices of a shortest path from the source of the last sssp_tree to t,
+  // empty if t is unreachable
+  sequence<NodeId> path(NodeId t) const {
+    if (parent.empty()) {
+      std::cerr << "Error: path needs the parents of sssp_tree" << std::endl;
+      abort();
+    }
+    sequence<NodeId> ret;
+    if (parent[t] != NODE_MAX) {
+      ret.push_back(t);
+      for (NodeId v = t; parent[v] != v; v = parent[v]) {
+        if (ret.size() > G.n) {
+          std::cerr << "Error: the parents of " << t << " form a cycle"
+                    << std::endl;
+          abort();
+        }
+        ret.push_back(parent[v]);
       }
-      // printf("pack: %f\n", t.next_time());
-      sparse = next_sparse;
+      std::reverse(ret.begin(), ret.end());
     }
-    return dist;
+    return ret;
   }
+
+  // Searches from s like sssp, but leaves the distances in the solver instead
+  // of copying them out. Returns the reached vertices, whose distances are
+  // given by distance(v) until the next search. As the next search resets
+  // only these vertices, a search that reaches a small part of the graph
+  // costs time proportional to that part.
+  auto sssp_reached(NodeId s) {
+    track_visited();
+    search(s);
+    return visited.cut(0, num_visited);
+  }
+
+  DistTy distance(NodeId v) const { return dist[v]; }
+
+  // Number of vertices reached by the last sssp_tree, sssp_reached or
+  // distance(s, t)
+  size_t num_reached() const { return num_visited; }
+
+  // Distance from s to t, DIST_MAX if t is unreachable. The search stops once
+  // no vertex in the frontier is closer than t, so it reaches about the
+  // vertices closer to s than t is. Weights must be nonnegative.
+  DistTy distance(NodeId s, NodeId t) {
+    track_visited();
+    start(s);
+    while (frontier_size &&
+           (dist[t] == DIST_MAX || frontier_min() < dist[t])) {
+      step();
+    }
+    finish();
+    return dist[t];
+  }
+
+  template <class, class, template <class, class> class>
+  friend class Bidirectional_SSSP;
 };
 
-template <class Graph>
-class Rho_Stepping : public SSSP<Graph> {
+template <class Graph, class DistTy = typename Graph::EdgeTy>
+class Rho_Stepping : public SSSP<Graph, DistTy> {
   using NodeId = typename Graph::NodeId;
   using EdgeId = typename Graph::EdgeId;
-  using EdgeTy = typename Graph::EdgeTy;
-  using SSSP<Graph>::frontier_size;
-  using SSSP<Graph>::sparse;
-  using SSSP<Graph>::dist;
-  using SSSP<Graph>::frontier;
-  using SSSP<Graph>::G;
-  using SSSP<Graph>::in_frontier;
-
-  static constexpr EdgeTy DIST_MAX = numeric_limits<EdgeTy>::max();
+  using SSSP<Graph, DistTy>::frontier_size;
+  using SSSP<Graph, DistTy>::sparse;
+  using SSSP<Graph, DistTy>::key;
+  using SSSP<Graph, DistTy>::frontier;
+  using SSSP<Graph, DistTy>::G;
+  using SSSP<Graph, DistTy>::in_frontier;
+
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
   static constexpr size_t NUM_SAMPLES = 1024;
 
   size_t rho;
   uint32_t seed;
   void init() override { seed = 0; }
-  EdgeTy get_threshold() override {
+  DistTy get_threshold() override {
     if (frontier_size <= rho) {
       if (sparse) {
-        auto _dist = delayed_seq<EdgeTy>(
-            frontier_size, [&](size_t i) { return dist[frontier[i]]; });
+        auto _dist = delayed_seq<DistTy>(
+            frontier_size, [&](size_t i) { return key(frontier[i]); });
         return *max_element(_dist);
       } else {
         return DIST_MAX;
       }
     }
-    EdgeTy sample_dist[NUM_SAMPLES + 1];
+    DistTy sample_dist[NUM_SAMPLES + 1];
     for (size_t i = 0; i <= NUM_SAMPLES; i++) {
       if (sparse) {
         NodeId v = frontier[hash32(seed + i) % frontier_size];
-        sample_dist[i] = dist[v];
+        sample_dist[i] = key(v);
       } else {
         NodeId v = hash32(seed + i) % G.n;
         if (in_frontier[v]) {
-          sample_dist[i] = dist[v];
+          sample_dist[i] = key(v);
         } else {
           sample_dist[i] = DIST_MAX;
         }
@@ -286,37 +536,34 @@ class Rho_Stepping : public SSSP<Graph> {
 
  public:
   Rho_Stepping(const Graph &_G, size_t _rho = 1 << 20)
-      : SSSP<Graph>(_G), rho(_rho) {}
+      : SSSP<Graph, DistTy>(_G), rho(_rho) {}
 };
 
-template <class Graph>
-class Delta_Stepping : public SSSP<Graph> {
-  using EdgeTy = typename Graph::EdgeTy;
-
-  EdgeTy delta;
-  EdgeTy thres;
+template <class Graph, class DistTy = typename Graph::EdgeTy>
+class Delta_Stepping : public SSSP<Graph, DistTy> {
+  DistTy delta;
+  DistTy thres;
 
   void init() override { thres = 0; }
-  EdgeTy get_threshold() override {
+  DistTy get_threshold() override {
     thres += delta;
     return thres;
   }
 
  public:
-  Delta_Stepping(const Graph &_G, EdgeTy _delta = 1 << 15)
-      : SSSP<Graph>(_G), delta(_delta) {}
+  Delta_Stepping(const Graph &_G, DistTy _delta = 1 << 15)
+      : SSSP<Graph, DistTy>(_G), delta(_delta) {}
 };
 
-template <class Graph>
-class Bellman_Ford : public SSSP<Graph> {
+template <class Graph, class DistTy = typename Graph::EdgeTy>
+class Bellman_Ford : public SSSP<Graph, DistTy> {
   using NodeId = typename Graph::NodeId;
-  using EdgeTy = typename Graph::EdgeTy;
 
-  static constexpr EdgeTy DIST_MAX = numeric_limits<EdgeTy>::max();
+  static constexpr DistTy DIST_MAX = numeric_limits<DistTy>::max();
 
   void init() override {}
-  EdgeTy get_threshold() override { return DIST_MAX; }
+  DistTy get_threshold() override { return DIST_MAX; }
 
  public:
-  Bellman_Ford(const Graph &_G) : SSSP<Graph>(_G) {}
+  Bellman_Ford(const Graph &_G) : SSSP<Graph, DistTy>(_G) {}
 };
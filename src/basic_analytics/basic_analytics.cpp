@@ -33,7 +33,7 @@ int main(int argc, char *argv[]) {
   Graph G;
   G.read_graph(input_path);
 
-  G.make_inverse();
+  G.make_inverse(input_path);
 
   size_t max_out_degree = 0, min_out_degree = -1, zero_out_degree_count = 0;
   size_t max_in_degree = 0, min_in_degree = -1, zero_in_degree_count = 0;
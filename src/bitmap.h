@@ -0,0 +1,120 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+
+// A set of vertices with one bit per vertex, used for dense frontiers and
+// visited sets. Bits are set and cleared with atomic word operations, so
+// threads may update different vertices of the same word concurrently. Loops
+// over the set process a word of 64 vertices at a time and skip empty words.
+// Bits past n are always zero.
+class bitmap {
+ public:
+  static constexpr size_t WORD_BITS = 64;
+
+ private:
+  // words per block of pack_into
+  static constexpr size_t BLOCK_SIZE = 64;
+
+  size_t n;
+  parlay::sequence<uint64_t> words;
+
+ public:
+  bitmap() : n(0) {}
+  explicit bitmap(size_t _n)
+      : n(_n), words((_n + WORD_BITS - 1) / WORD_BITS, 0) {}
+
+  size_t size() const { return n; }
+  size_t num_words() const { return words.size(); }
+  size_t size_in_bytes() const { return words.size() * sizeof(uint64_t); }
+
+  // Words may be read and written directly by loops in which each word is
+  // written by a single thread
+  uint64_t &word(size_t w) { return words[w]; }
+  uint64_t word(size_t w) const { return words[w]; }
+  const uint64_t *data() const { return words.data(); }
+
+  // The bits of word w that stand for vertices
+  uint64_t word_mask(size_t w) const {
+    size_t rest = n - w * WORD_BITS;
+    return rest >= WORD_BITS ? ~uint64_t{0} : (uint64_t{1} << rest) - 1;
+  }
+
+  bool get(size_t i) const {
+    return (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+  }
+
+  // Sets bit i and returns its previous value
+  bool test_and_set(size_t i) {
+    uint64_t bit = uint64_t{1} << (i % WORD_BITS);
+    return __atomic_fetch_or(&words[i / WORD_BITS], bit, __ATOMIC_RELAXED) &
+           bit;
+  }
+
+  void set(size_t i) { test_and_set(i); }
+
+  void reset(size_t i) {
+    uint64_t bit = uint64_t{1} << (i % WORD_BITS);
+    __atomic_fetch_and(&words[i / WORD_BITS], ~bit, __ATOMIC_RELAXED);
+  }
+
+  void clear() {
+    parlay::parallel_for(0, words.size(), [&](size_t w) { words[w] = 0; });
+  }
+
+  size_t count() const {
+    return parlay::reduce(
+        parlay::delayed_seq<size_t>(words.size(), [&](size_t w) {
+          return __builtin_popcountll(words[w]);
+        }));
+  }
+
+  // Calls f(i) on the vertices i in the set in parallel
+  template <class F>
+  void for_each(F &&f) const {
+    parlay::parallel_for(0, words.size(), [&](size_t w) {
+      uint64_t bits = words[w];
+      while (bits) {
+        f(w * WORD_BITS + __builtin_ctzll(bits));
+        bits &= bits - 1;
+      }
+    });
+  }
+
+  // Writes the vertices in the set to out in increasing order and returns how
+  // many there are
+  template <class Seq>
+  size_t pack_into(Seq &&out) const {
+    using T = typename std::remove_reference_t<Seq>::value_type;
+    size_t num_blocks = (words.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    auto offsets = parlay::tabulate(num_blocks, [&](size_t b) -> size_t {
+      size_t end = std::min((b + 1) * BLOCK_SIZE, words.size());
+      size_t count = 0;
+      for (size_t w = b * BLOCK_SIZE; w < end; w++) {
+        count += __builtin_popcountll(words[w]);
+      }
+      return count;
+    });
+    size_t total = parlay::scan_inplace(offsets);
+    parlay::parallel_for(0, num_blocks, [&](size_t b) {
+      size_t end = std::min((b + 1) * BLOCK_SIZE, words.size());
+      size_t k = offsets[b];
+      for (size_t w = b * BLOCK_SIZE; w < end; w++) {
+        uint64_t bits = words[w];
+        while (bits) {
+          out[k++] = static_cast<T>(w * WORD_BITS + __builtin_ctzll(bits));
+          bits &= bits - 1;
+        }
+      }
+    });
+    return total;
+  }
+};
+
+#endif  // BITMAP_H
@@ -0,0 +1,344 @@
+#ifndef COMPRESSED_GRAPH_H
+#define COMPRESSED_GRAPH_H
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "graph.h"
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+
+// CSR whose neighbor lists are stored with difference and variable-byte
+// encoding. The neighbors of every vertex are sorted and split into blocks of
+// BLOCK_SIZE edges that are decoded independently: the first neighbor of a
+// block is stored relative to the source vertex (zigzag encoded) and the
+// others relative to their predecessor. The bytes of vertex u start at
+// byte_offsets[u] and are laid out as
+//   degree | byte offsets of blocks 1..k-1 (uint32) | block 0 | ... | block k-1
+// so that the blocks of high-degree vertices are decoded in parallel. Integral
+// weights follow their neighbor as (zigzag) varints, other weights are copied
+// verbatim.
+template <class NodeId, class EdgeTy>
+class compressed_csr {
+  using Edge = WEdge<NodeId, EdgeTy>;
+
+  static constexpr uint64_t zigzag(int64_t x) {
+    return (static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63);
+  }
+  static constexpr int64_t unzigzag(uint64_t x) {
+    return static_cast<int64_t>(x >> 1) ^ -static_cast<int64_t>(x & 1);
+  }
+
+  // Writes through out unless it is null, and returns the number of bytes
+  static size_t write_varint(uint8_t *out, uint64_t x) {
+    size_t len = 0;
+    while (x >= 0x80) {
+      if (out) out[len] = static_cast<uint8_t>(x) | 0x80;
+      x >>= 7;
+      len++;
+    }
+    if (out) out[len] = static_cast<uint8_t>(x);
+    return len + 1;
+  }
+
+  static uint64_t read_varint(const uint8_t *&p) {
+    uint64_t x = *p & 0x7f;
+    for (int shift = 7; *p++ & 0x80; shift += 7) {
+      x |= static_cast<uint64_t>(*p & 0x7f) << shift;
+    }
+    return x;
+  }
+
+  static size_t write_weight(uint8_t *out, [[maybe_unused]] EdgeTy w) {
+    if constexpr (std::is_same_v<EdgeTy, Empty>) {
+      return 0;
+    } else if constexpr (std::is_integral_v<EdgeTy> &&
+                         std::is_signed_v<EdgeTy>) {
+      return write_varint(out, zigzag(w));
+    } else if constexpr (std::is_integral_v<EdgeTy>) {
+      return write_varint(out, w);
+    } else {
+      if (out) memcpy(out, &w, sizeof(EdgeTy));
+      return sizeof(EdgeTy);
+    }
+  }
+
+  static EdgeTy read_weight([[maybe_unused]] const uint8_t *&p) {
+    if constexpr (std::is_same_v<EdgeTy, Empty>) {
+      return EdgeTy();
+    } else if constexpr (std::is_integral_v<EdgeTy> &&
+                         std::is_signed_v<EdgeTy>) {
+      return static_cast<EdgeTy>(unzigzag(read_varint(p)));
+    } else if constexpr (std::is_integral_v<EdgeTy>) {
+      return static_cast<EdgeTy>(read_varint(p));
+    } else {
+      EdgeTy w;
+      memcpy(&w, p, sizeof(EdgeTy));
+      p += sizeof(EdgeTy);
+      return w;
+    }
+  }
+
+  static size_t blocks_of(size_t deg) {
+    return (deg + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  }
+
+  // Encodes the sorted neighbors of u to out (or only measures them if out is
+  // null) and returns the number of bytes
+  template <class Neighbors>
+  static size_t encode(NodeId u, const Neighbors &neighbors, uint8_t *out) {
+    size_t deg = neighbors.size();
+    size_t pos = write_varint(out, deg);
+    if (deg == 0) {
+      return pos;
+    }
+    size_t table = pos;
+    pos += (blocks_of(deg) - 1) * sizeof(uint32_t);
+    for (size_t i = 0; i < deg; i++) {
+      NodeId v = neighbors[i].v;
+      uint8_t *p = out ? out + pos : nullptr;
+      if (i % BLOCK_SIZE == 0) {
+        if (i != 0) {
+          if (pos > std::numeric_limits<uint32_t>::max()) {
+            std::cerr << "Error: Neighbor list of vertex " << u
+                      << " is too large to compress" << std::endl;
+            abort();
+          }
+          if (out) {
+            uint32_t offset = pos;
+            memcpy(out + table + (i / BLOCK_SIZE - 1) * sizeof(uint32_t),
+                   &offset, sizeof(uint32_t));
+          }
+        }
+        pos += write_varint(p, zigzag(static_cast<int64_t>(v) -
+                                      static_cast<int64_t>(u)));
+      } else {
+        pos += write_varint(p, v - neighbors[i - 1].v);
+      }
+      pos += write_weight(out ? out + pos : nullptr, neighbors[i].w);
+    }
+    return pos;
+  }
+
+  // Calls g on the neighbor list of u sorted by (v, w)
+  template <class Edges, class G>
+  static void with_sorted_neighbors(const Edges &edges, size_t start,
+                                    size_t end, G &&g) {
+    auto neighbors = edges.cut(start, end);
+    if (std::is_sorted(neighbors.begin(), neighbors.end())) {
+      g(neighbors);
+    } else {
+      auto sorted = parlay::to_sequence(neighbors);
+      if (sorted.size() > (1 << 14)) {
+        parlay::sort_inplace(sorted);
+      } else {
+        std::sort(sorted.begin(), sorted.end());
+      }
+      g(sorted);
+    }
+  }
+
+ public:
+  static constexpr size_t BLOCK_SIZE = 256;
+
+  parlay::sequence<uint64_t> byte_offsets;
+  parlay::sequence<uint8_t> data;
+
+  compressed_csr() = default;
+
+  template <class Offsets, class Edges>
+  compressed_csr(size_t n, const Offsets &offsets, const Edges &edges) {
+    byte_offsets = parlay::sequence<uint64_t>(n + 1);
+    parlay::parallel_for(0, n, [&](size_t u) {
+      with_sorted_neighbors(edges, offsets[u], offsets[u + 1],
+                            [&](const auto &neighbors) {
+                              byte_offsets[u] = encode(u, neighbors, nullptr);
+                            });
+    });
+    byte_offsets[n] = 0;
+    size_t num_bytes = parlay::scan_inplace(byte_offsets);
+    byte_offsets[n] = num_bytes;
+    data = parlay::sequence<uint8_t>::uninitialized(num_bytes);
+    parlay::parallel_for(0, n, [&](size_t u) {
+      with_sorted_neighbors(edges, offsets[u], offsets[u + 1],
+                            [&](const auto &neighbors) {
+                              encode(u, neighbors,
+                                     data.begin() + byte_offsets[u]);
+                            });
+    });
+  }
+
+  size_t size_in_bytes() const {
+    return byte_offsets.size() * sizeof(uint64_t) + data.size();
+  }
+
+  size_t degree(NodeId u) const {
+    const uint8_t *p = data.begin() + byte_offsets[u];
+    return read_varint(p);
+  }
+
+  size_t num_blocks(NodeId u) const { return blocks_of(degree(u)); }
+
+  template <class F>
+  bool decode_all(NodeId u, F &&f) const {
+    return decode(u, 0, std::numeric_limits<size_t>::max(), f);
+  }
+
+  // Calls f(v, w) on the neighbors of u in blocks [first, last) until f
+  // returns true, and returns whether it did. last is clamped to the number
+  // of blocks of u.
+  template <class F>
+  bool decode(NodeId u, size_t first, size_t last, F &&f) const {
+    const uint8_t *start = data.begin() + byte_offsets[u];
+    const uint8_t *p = start;
+    size_t deg = read_varint(p);
+    last = std::min(last, blocks_of(deg));
+    if (first >= last) {
+      return false;
+    }
+    if (first == 0) {
+      p += (blocks_of(deg) - 1) * sizeof(uint32_t);
+    } else {
+      uint32_t offset;
+      memcpy(&offset, p + (first - 1) * sizeof(uint32_t), sizeof(uint32_t));
+      p = start + offset;
+    }
+    for (size_t k = first; k < last; k++) {
+      size_t end = std::min(deg, (k + 1) * BLOCK_SIZE);
+      NodeId v = static_cast<NodeId>(static_cast<int64_t>(u) +
+                                     unzigzag(read_varint(p)));
+      EdgeTy w = read_weight(p);
+      if (f(v, w)) {
+        return true;
+      }
+      for (size_t i = k * BLOCK_SIZE + 1; i < end; i++) {
+        v += static_cast<NodeId>(read_varint(p));
+        w = read_weight(p);
+        if (f(v, w)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+};
+
+// Read-only graph with compressed neighbor lists (see compressed_csr). It
+// provides the same neighbor iteration interface as Graph, so algorithms
+// written against that interface (BFS, SSSP, REACH, LDD) take it as their
+// Graph template parameter. Decoding is sequential inside a block of
+// compressed_csr::BLOCK_SIZE edges, so block sizes requested by parallel
+// iteration are rounded up to a multiple of it.
+template <class _NodeId = uint32_t, class _EdgeId = uint64_t,
+          class _EdgeTy = Empty>
+class CompressedGraph {
+ public:
+  using NodeId = _NodeId;
+  using EdgeId = _EdgeId;
+  using EdgeTy = _EdgeTy;
+  using CSR = compressed_csr<NodeId, EdgeTy>;
+
+  size_t n;
+  size_t m;
+  bool symmetrized;
+  bool weighted;
+  CSR out_csr;
+  CSR in_csr;
+
+  CompressedGraph() {
+    n = m = 0;
+    symmetrized = weighted = false;
+  }
+
+  // Compresses G, including its in-CSR if G is directed and has one
+  explicit CompressedGraph(const Graph<_NodeId, _EdgeId, _EdgeTy> &G)
+      : n(G.n),
+        m(G.m),
+        symmetrized(G.symmetrized),
+        weighted(G.weighted),
+        out_csr(G.n, G.offsets, G.edges) {
+    if (!symmetrized && G.in_offsets.size() == n + 1) {
+      in_csr = CSR(n, G.in_offsets, G.in_edges);
+    }
+  }
+
+  size_t size_in_bytes() const {
+    return out_csr.size_in_bytes() + in_csr.size_in_bytes();
+  }
+
+  size_t degree(NodeId u) const { return out_csr.degree(u); }
+
+  size_t in_degree(NodeId u) const {
+    if (symmetrized) {
+      return degree(u);
+    } else {
+      return in_csr.degree(u);
+    }
+  }
+
+  template <class F>
+  void map_neighbors(NodeId u, F &&f) const {
+    out_csr.decode_all(u, [&](NodeId v, EdgeTy w) {
+      f(v, w);
+      return false;
+    });
+  }
+
+  template <class F>
+  void map_neighbors_until(NodeId u, F &&f) const {
+    out_csr.decode_all(u, f);
+  }
+
+  template <class F>
+  void map_in_neighbors_until(NodeId u, F &&f) const {
+    const CSR &csr = symmetrized ? out_csr : in_csr;
+    csr.decode_all(u, f);
+  }
+
+  template <class G>
+  void map_neighbor_blocks(NodeId u, size_t block_size, G &&g) const {
+    map_blocks(out_csr, u, block_size, g);
+  }
+
+  template <class G>
+  void map_in_neighbor_blocks(NodeId u, size_t block_size, G &&g) const {
+    map_blocks(symmetrized ? out_csr : in_csr, u, block_size, g);
+  }
+
+  template <class F>
+  void map_neighbors_parallel(NodeId u, F &&f, size_t block_size) const {
+    map_neighbor_blocks(u, block_size,
+                        [&](auto &&map_block) { map_block(f); });
+  }
+
+  template <class F>
+  void map_in_neighbors_parallel(NodeId u, F &&f, size_t block_size) const {
+    map_blocks(symmetrized ? out_csr : in_csr, u, block_size,
+               [&](auto &&map_block) { map_block(f); });
+  }
+
+ private:
+  template <class G>
+  static void map_blocks(const CSR &csr, NodeId u, size_t block_size, G &&g) {
+    size_t num_blocks = csr.num_blocks(u);
+    size_t group = std::max(block_size / CSR::BLOCK_SIZE, size_t{1});
+    size_t num_groups = (num_blocks + group - 1) / group;
+    parlay::parallel_for(
+        0, num_groups,
+        [&](size_t i) {
+          size_t first = i * group;
+          size_t last = std::min(first + group, num_blocks);
+          g([&](auto &&f) {
+            csr.decode(u, first, last, [&](NodeId v, EdgeTy w) {
+              f(v, w);
+              return false;
+            });
+          });
+        },
+        1);
+  }
+};
+
+#endif  // COMPRESSED_GRAPH_H
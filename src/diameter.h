@@ -0,0 +1,209 @@
+#ifndef DIAMETER_H
+#define DIAMETER_H
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+#include "BFS/bfs.h"
+#include "connectivity.h"
+#include "graph.h"
+#include "parlay/internal/get_time.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "utils.h"
+
+// Exact diameter of unweighted graphs by eccentricity bounds (Takes and
+// Kosters, "Determining the diameter of small world networks", 2011), where
+// the eccentricity ecc(v) of v is the largest finite distance from v and the
+// diameter is the largest eccentricity. Every vertex w keeps bounds
+// lower[w] <= ecc(w) <= upper[w]. A search from v finds ecc(v) and tightens
+// the bounds of the vertices w that reach v:
+//   ecc(w) >= d(w, v)
+// and, if w is also reached from v (w and v are strongly connected),
+//   ecc(v) - d(v, w) <= ecc(w) <= d(w, v) + ecc(v)
+// Directed graphs run a backward search on the transpose for d(w, v). Vertices
+// are dropped from the candidates once their bounds meet, or once they can
+// neither raise the largest lower bound nor, as a source, lower the largest
+// upper bound. Searches alternate between the candidate with the largest upper
+// bound and the one with the smallest lower bound, so that a few searches from
+// peripheral and central vertices settle most of the graph.
+//
+// The upper bounds start at the size of the connected component minus one on
+// undirected graphs, which also drops the vertices of small components. On
+// directed graphs they start at n - 1 and are lowered by
+// ecc(w) <= 1 + max ecc(u) over the out-neighbors u of w after every search,
+// which settles vertices outside the large strongly connected components.
+template <class Graph>
+class Diameter {
+ public:
+  using NodeId = typename Graph::NodeId;
+
+  static constexpr NodeId DIST_MAX = numeric_limits<NodeId>::max();
+
+  struct Result {
+    NodeId lower;  // eccentricity of some vertex
+    NodeId upper;  // no vertex has a larger eccentricity
+    size_t num_searches;
+    bool exact() const { return lower == upper; }
+  };
+
+ private:
+  const Graph &G;
+  TransposedGraph<Graph> GT;
+  BFS<Graph> forward;
+  // directed graphs only
+  optional<BFS<TransposedGraph<Graph>>> backward;
+  sequence<NodeId> lower;
+  sequence<NodeId> upper;
+  sequence<NodeId> candidates;
+  // size of the connected component minus one, undirected graphs only
+  sequence<NodeId> component_bound;
+  NodeId max_lower;
+  size_t num_searches;
+
+  NodeId max_upper() const {
+    if (candidates.empty()) {
+      return max_lower;
+    }
+    return max(max_lower,
+               reduce(delayed_seq<NodeId>(
+                          candidates.size(),
+                          [&](size_t i) { return upper[candidates[i]]; }),
+                      maxm<NodeId>()));
+  }
+
+  // Searches from v in both directions and tightens the bounds of the
+  // vertices that reach v
+  void search(NodeId v) {
+    num_searches++;
+    auto reached = forward.bfs_reached(v);
+    NodeId ecc = reduce(
+        delayed_seq<NodeId>(reached.size(),
+                            [&](size_t i) {
+                              return forward.distance(reached[i]);
+                            }),
+        maxm<NodeId>());
+    auto reaching = G.symmetrized ? reached : backward->bfs_reached(v);
+    parallel_for(0, reaching.size(), [&](size_t i) {
+      NodeId w = reaching[i];
+      NodeId to = G.symmetrized ? forward.distance(w) : backward->distance(w);
+      NodeId from = forward.distance(w);
+      NodeId lo = to;
+      if (from != DIST_MAX) {
+        lo = max(lo, ecc - from);
+        upper[w] = min(upper[w], to + ecc);
+      }
+      lower[w] = max(lower[w], lo);
+    });
+    lower[v] = upper[v] = ecc;
+    max_lower = max(max_lower, reduce(delayed_seq<NodeId>(
+                                          reaching.size(),
+                                          [&](size_t i) {
+                                            return lower[reaching[i]];
+                                          }),
+                                      maxm<NodeId>()));
+  }
+
+  // ecc(w) <= 1 + max ecc(u) over the out-neighbors u of w
+  void tighten_by_neighbors() {
+    parallel_for(0, candidates.size(), [&](size_t i) {
+      NodeId w = candidates[i];
+      NodeId bound = 0;
+      G.map_neighbors(w, [&](NodeId u, auto) {
+        bound = max(bound, upper[u] + 1);
+      });
+      if (bound < upper[w]) {
+        upper[w] = bound;
+      }
+    });
+  }
+
+  // Returns the largest upper bound. A search from w only lowers the upper
+  // bounds in its component, which are at most component_bound[w].
+  NodeId drop_candidates() {
+    NodeId du = max_upper();
+    candidates = parlay::filter(candidates, [&](NodeId w) {
+      bool useless_source =
+          2 * (size_t)lower[w] >= du ||
+          (!component_bound.empty() && component_bound[w] <= max_lower);
+      return lower[w] != upper[w] && !(upper[w] <= max_lower && useless_source);
+    });
+    return du;
+  }
+
+ public:
+  Diameter() = delete;
+  // Directed graphs need their in-CSR
+  Diameter(const Graph &_G)
+      : G(_G), GT(_G), forward(_G), max_lower(0), num_searches(0) {
+    if (!G.symmetrized) {
+      backward.emplace(GT);
+    }
+    lower = sequence<NodeId>(G.n, 0);
+    if (G.symmetrized) {
+      auto label = get_cc(G);
+      sequence<NodeId> size(G.n, 0);
+      parallel_for(0, G.n, [&](NodeId v) {
+        __atomic_fetch_add(&size[label[v]], 1, __ATOMIC_RELAXED);
+      });
+      component_bound = tabulate(G.n, [&](NodeId v) -> NodeId {
+        return size[label[v]] - 1;
+      });
+      upper = component_bound;
+    } else {
+      upper = tabulate(G.n, [&](NodeId v) -> NodeId {
+        return G.degree(v) ? G.n - 1 : 0;
+      });
+    }
+    candidates = pack_index<NodeId>(delayed_seq<bool>(
+        G.n, [&](NodeId v) { return lower[v] != upper[v]; }));
+  }
+
+  // Eccentricity of v
+  NodeId eccentricity(NodeId v) {
+    if (lower[v] != upper[v]) {
+      search(v);
+    }
+    return lower[v];
+  }
+
+  // The diameter, or bounds on it if time_limit seconds run out first
+  Result diameter(double time_limit = numeric_limits<double>::infinity()) {
+    internal::timer t;
+    auto by_degree = [&](NodeId u, NodeId v) {
+      return G.degree(u) < G.degree(v);
+    };
+    bool largest_upper = true;
+    if (!candidates.empty()) {
+      search(*parlay::max_element(candidates, by_degree));
+    }
+    while (true) {
+      if (!G.symmetrized) {
+        tighten_by_neighbors();
+      }
+      NodeId du = drop_candidates();
+      t.next_time();
+      if (max_lower == du || t.total_time() >= time_limit) {
+        break;
+      }
+      NodeId v;
+      if (largest_upper) {
+        v = *parlay::max_element(candidates, [&](NodeId u, NodeId w) {
+          return upper[u] < upper[w] ||
+                 (upper[u] == upper[w] && by_degree(u, w));
+        });
+      } else {
+        v = *parlay::min_element(candidates, [&](NodeId u, NodeId w) {
+          return lower[u] < lower[w] ||
+                 (lower[u] == lower[w] && by_degree(w, u));
+        });
+      }
+      largest_upper = !largest_upper;
+      search(v);
+    }
+    return {max_lower, max_upper(), num_searches};
+  }
+};
+
+#endif  // DIAMETER_H
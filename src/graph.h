@@ -2,17 +2,22 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <unistd.h>
-
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <vector>
 
+#include "mmap_array.h"
 #include "parlay/io.h"
 #include "parlay/parallel.h"
 #include "parlay/sequence.h"
@@ -21,14 +26,33 @@
 
 class Empty {};
 
-template <class NodeId, class EdgeTy>
-class WEdge {
- public:
+// Weights narrower than vertex ids are packed after them without padding, so
+// that e.g. 16-bit weights with 32-bit ids take 6 bytes per edge instead of 8
+template <class NodeId, class EdgeTy,
+          bool = !std::is_same_v<EdgeTy, Empty> &&
+                 (sizeof(EdgeTy) < sizeof(NodeId))>
+struct WEdgeFields {
   NodeId v;
   [[no_unique_address]] EdgeTy w;
+};
+
+template <class NodeId, class EdgeTy>
+struct __attribute__((packed)) WEdgeFields<NodeId, EdgeTy, true> {
+  NodeId v;
+  EdgeTy w;
+};
+
+template <class NodeId, class EdgeTy>
+class WEdge : public WEdgeFields<NodeId, EdgeTy> {
+ public:
+  using WEdgeFields<NodeId, EdgeTy>::v;
+  using WEdgeFields<NodeId, EdgeTy>::w;
   WEdge() {}
-  WEdge(NodeId _v) : v(_v) {}
-  WEdge(NodeId _v, EdgeTy _w) : v(_v), w(_w) {}
+  WEdge(NodeId _v) { v = _v; }
+  WEdge(NodeId _v, EdgeTy _w) {
+    v = _v;
+    w = _w;
+  }
 
   bool operator<(const WEdge &rhs) const {
     if constexpr (std::is_same_v<EdgeTy, Empty>) {
@@ -50,6 +74,371 @@ class WEdge {
   }
 };
 
+// Header of the PASGAL binary graph format. Unlike the GBBS format, it
+// records the widths of the stored types and can carry edge weights. The file
+// is laid out as
+//   header | offsets[n + 1] | targets[m] | weights[m]
+// where every array starts at a multiple of 8 bytes, and the weights are
+// omitted for unweighted graphs (weight_bytes = 0).
+struct BinaryHeader {
+  static constexpr uint64_t MAGIC = 0x52474c4147534150;  // "PASGALGR"
+  static constexpr uint32_t VERSION = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint8_t node_id_bytes;
+  uint8_t edge_id_bytes;
+  uint8_t weight_bytes;
+  uint8_t weight_type;  // 'u' unsigned, 'i' signed or 'f' floating point
+  uint64_t n;
+  uint64_t m;
+  uint64_t sizes;  // size of the file in bytes
+
+  static size_t align(size_t bytes) { return (bytes + 7) / 8 * 8; }
+  size_t offsets_pos() const { return sizeof(BinaryHeader); }
+  size_t edges_pos() const {
+    return offsets_pos() + align((n + 1) * edge_id_bytes);
+  }
+  size_t weights_pos() const { return edges_pos() + align(m * node_id_bytes); }
+  size_t file_size() const { return weights_pos() + align(m * weight_bytes); }
+};
+static_assert(sizeof(BinaryHeader) == 40);
+
+// Header of the sidecar file that caches the in-CSR of a directed graph. It is
+// followed by in_offsets[n + 1] and the in_edges[m] array as stored in memory,
+// each starting at a multiple of 8 bytes. The cache is only valid for a graph
+// with the same n, m and checksum, stored with the same types.
+struct TransposeHeader {
+  static constexpr uint64_t MAGIC = 0x52544c4147534150;  // "PASGALTR"
+  static constexpr uint32_t VERSION = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint8_t node_id_bytes;
+  uint8_t edge_id_bytes;
+  uint8_t edge_bytes;
+  uint8_t weight_type;
+  uint64_t n;
+  uint64_t m;
+  uint64_t checksum;  // checksum of the graph the transpose was built from
+
+  static size_t align(size_t bytes) { return (bytes + 7) / 8 * 8; }
+  size_t in_offsets_pos() const { return sizeof(TransposeHeader); }
+  size_t in_edges_pos() const {
+    return in_offsets_pos() + align((n + 1) * edge_id_bytes);
+  }
+  size_t file_size() const { return in_edges_pos() + align(m * edge_bytes); }
+};
+static_assert(sizeof(TransposeHeader) == 40);
+
+// Type code of edge weights in the binary formats
+template <class EdgeTy>
+constexpr uint8_t weight_type_code() {
+  if constexpr (std::is_floating_point_v<EdgeTy>) {
+    return 'f';
+  } else if constexpr (std::is_signed_v<EdgeTy>) {
+    return 'i';
+  } else {
+    return 'u';
+  }
+}
+
+// Parses the number in [first, last)
+template <class T>
+T parse_number(const char *first, const char *last) {
+  T value;
+  auto [ptr, ec] = std::from_chars(first, last, value);
+  if (ec != std::errc() || ptr != last) {
+    std::cerr << "Error: Bad number " << std::string(first, last) << std::endl;
+    abort();
+  }
+  return value;
+}
+
+template <class T>
+T parse_number(std::string_view token) {
+  return parse_number<T>(token.data(), token.data() + token.size());
+}
+
+// Appends x and a newline to out. Non-integral values are printed with
+// std::to_string.
+template <class T>
+void append_line(std::string &out, T x) {
+  if constexpr (std::is_integral_v<T>) {
+    char buffer[24];
+    auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), x);
+    out.append(buffer, ptr);
+  } else {
+    out += std::to_string(x);
+  }
+  out += '\n';
+}
+
+// Writes header followed by the lines that format(i, out) appends to out for
+// i in [0, n). Blocks of lines are formatted twice in parallel, once to
+// measure them and once to write them at their offset in the file, so the
+// text is never held in memory as a whole.
+template <class F>
+void write_text_file(const char *filename, const std::string &header, size_t n,
+                     F &&format) {
+  constexpr size_t LINES_PER_BLOCK = 1 << 16;
+  size_t num_blocks = (n + LINES_PER_BLOCK - 1) / LINES_PER_BLOCK;
+  auto format_block = [&](size_t i, std::string &out) {
+    size_t end = std::min((i + 1) * LINES_PER_BLOCK, n);
+    for (size_t j = i * LINES_PER_BLOCK; j < end; j++) {
+      format(j, out);
+    }
+  };
+  auto block_offsets = parlay::sequence<size_t>(num_blocks + 1);
+  parlay::parallel_for(
+      0, num_blocks,
+      [&](size_t i) {
+        std::string out;
+        format_block(i, out);
+        block_offsets[i] = out.size();
+      },
+      1);
+  block_offsets[num_blocks] = 0;
+  size_t size = header.size() + parlay::scan_inplace(block_offsets);
+
+  output_file file;
+  if (!file.open(filename, size)) {
+    std::cerr << "Error: Cannot open file " << filename << std::endl;
+    abort();
+  }
+  file.write(header.data(), header.size(), 0);
+  parlay::parallel_for(
+      0, num_blocks,
+      [&](size_t i) {
+        std::string out;
+        out.reserve(block_offsets[i + 1] - block_offsets[i]);
+        format_block(i, out);
+        file.write(out.data(), out.size(), header.size() + block_offsets[i]);
+      },
+      1);
+  if (!file.close()) {
+    std::cerr << "Error: Cannot write file " << filename << std::endl;
+    abort();
+  }
+}
+
+// Reads the i-th element of an array of unsigned integers of the given width
+inline uint64_t read_uint(const char *base, size_t bytes, size_t i) {
+  switch (bytes) {
+    case 1:
+      return reinterpret_cast<const uint8_t *>(base)[i];
+    case 2:
+      return reinterpret_cast<const uint16_t *>(base)[i];
+    case 4:
+      return reinterpret_cast<const uint32_t *>(base)[i];
+    default:
+      return reinterpret_cast<const uint64_t *>(base)[i];
+  }
+}
+
+// Converts a weight x to type T, and sets lossy if that changes its value
+template <class T, class S>
+T convert_weight(S x, std::atomic<bool> &lossy) {
+  T w = static_cast<T>(x);
+  bool negative = false;
+  if constexpr (std::is_signed_v<S>) {
+    negative = x < 0;
+  }
+  if (static_cast<S>(w) != x || (negative && !std::is_signed_v<T>)) {
+    lossy.store(true, std::memory_order_relaxed);
+  }
+  return w;
+}
+
+// Reads the i-th element of the weight array described by header as type T,
+// and sets lossy if T cannot hold its value
+template <class T>
+T read_weight(const char *base, const BinaryHeader &header, size_t i,
+              std::atomic<bool> &lossy) {
+  if (header.weight_type == 'f') {
+    if (header.weight_bytes == 4) {
+      return convert_weight<T>(reinterpret_cast<const float *>(base)[i], lossy);
+    } else {
+      return convert_weight<T>(reinterpret_cast<const double *>(base)[i],
+                               lossy);
+    }
+  } else if (header.weight_type == 'i') {
+    switch (header.weight_bytes) {
+      case 1:
+        return convert_weight<T>(reinterpret_cast<const int8_t *>(base)[i],
+                                 lossy);
+      case 2:
+        return convert_weight<T>(reinterpret_cast<const int16_t *>(base)[i],
+                                 lossy);
+      case 4:
+        return convert_weight<T>(reinterpret_cast<const int32_t *>(base)[i],
+                                 lossy);
+      default:
+        return convert_weight<T>(reinterpret_cast<const int64_t *>(base)[i],
+                                 lossy);
+    }
+  } else {
+    return convert_weight<T>(read_uint(base, header.weight_bytes, i), lossy);
+  }
+}
+
+// Calls f(u, i) sequentially for the edges i in [begin, end) of a CSR with n
+// vertices, where u is the source of edge i
+template <class Offsets, class F>
+void for_csr_range(const Offsets &offsets, size_t n, size_t begin, size_t end,
+                   F &&f) {
+  if (begin >= end) {
+    return;
+  }
+  size_t u = std::upper_bound(offsets.begin(), offsets.begin() + n + 1,
+                              begin) -
+             offsets.begin() - 1;
+  for (size_t i = begin; i < end; i++) {
+    while (offsets[u + 1] <= i) {
+      u++;
+    }
+    f(u, i);
+  }
+}
+
+// Builds a CSR with n vertices from m edges with a stable counting sort.
+// for_range(begin, end, f) has to call f(u, e) sequentially and in order for
+// the input edges begin, ..., end - 1, where u is the vertex whose list
+// receives e. Edges are first distributed to ranges of 2^shift vertices: each
+// block of input edges counts its edges per range, a scan of the counts gives
+// every block its slots in every range, and the blocks copy their edges there
+// in order. Each range is then sorted by vertex on its own in the same way:
+// sequentially if it has few edges, and otherwise in parallel sub-blocks of
+// at least as many edges as the range has vertices, so that a range with
+// many edges (in-hubs, or graphs with few vertices) is not sorted by one
+// task. This takes linear work and no atomics, and neighbor lists keep the
+// input order, so they are sorted when the input is sorted by target.
+template <class EdgeId, class Edge, class ForRange>
+std::pair<parlay::sequence<EdgeId>, parlay::sequence<Edge>> csr_from_edges(
+    size_t n, size_t m, ForRange &&for_range) {
+  using NodeId = decltype(Edge::v);
+  if (m == 0) {
+    return {parlay::sequence<EdgeId>(n + 1, 0), parlay::sequence<Edge>()};
+  }
+  constexpr size_t BLOCK_SIZE = 1 << 16;
+  size_t num_blocks = (m + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  // Ranges are as small as possible with at most m + n block counts
+  size_t shift = 0;
+  while (((n >> shift) + 1) * num_blocks > m + n) {
+    shift++;
+  }
+  size_t num_ranges = (n >> shift) + 1;
+  auto block_range = [&](size_t b) {
+    return std::make_pair(b * BLOCK_SIZE, std::min((b + 1) * BLOCK_SIZE, m));
+  };
+
+  // counts[r * num_blocks + b] is the number of edges of block b in range r,
+  // and then the next slot of block b in range r
+  auto counts = parlay::sequence<EdgeId>(num_ranges * num_blocks, 0);
+  parlay::parallel_for(
+      0, num_blocks,
+      [&](size_t b) {
+        auto [begin, end] = block_range(b);
+        for_range(begin, end, [&](size_t u, const Edge &) {
+          counts[(u >> shift) * num_blocks + b]++;
+        });
+      },
+      1);
+  parlay::scan_inplace(counts);
+  auto range_offsets = parlay::tabulate(num_ranges + 1, [&](size_t r) {
+    return r == num_ranges ? m : (size_t)counts[r * num_blocks];
+  });
+  // Edges grouped by range, and their vertices relative to the range
+  auto grouped = parlay::sequence<Edge>::uninitialized(m);
+  auto local = parlay::sequence<NodeId>::uninitialized(m);
+  parlay::parallel_for(
+      0, num_blocks,
+      [&](size_t b) {
+        auto [begin, end] = block_range(b);
+        for_range(begin, end, [&](size_t u, const Edge &e) {
+          EdgeId &slot = counts[(u >> shift) * num_blocks + b];
+          grouped[slot] = e;
+          local[slot] = u & ((size_t{1} << shift) - 1);
+          slot++;
+        });
+      },
+      1);
+
+  auto offsets = parlay::sequence<EdgeId>(n + 1, 0);
+  auto edges = parlay::sequence<Edge>::uninitialized(m);
+  parlay::parallel_for(
+      0, num_ranges,
+      [&](size_t r) {
+        size_t first = r << shift;
+        size_t last = std::min((r + 1) << shift, n);
+        if (first >= last) {
+          return;
+        }
+        size_t size = last - first;
+        size_t range_start = range_offsets[r];
+        size_t range_end = range_offsets[r + 1];
+        size_t sub_block_size = std::max(BLOCK_SIZE, size);
+        size_t num_sub_blocks =
+            (range_end - range_start + sub_block_size - 1) / sub_block_size;
+        if (num_sub_blocks > 1) {
+          // sub_counts[u * num_sub_blocks + j] is the number of edges of
+          // vertex u in sub-block j, and then the next slot of u in j
+          auto sub_counts = parlay::sequence<EdgeId>(size * num_sub_blocks, 0);
+          auto sub_block = [&](size_t j) {
+            size_t begin = range_start + j * sub_block_size;
+            return std::make_pair(begin,
+                                  std::min(begin + sub_block_size, range_end));
+          };
+          parlay::parallel_for(
+              0, num_sub_blocks,
+              [&](size_t j) {
+                auto [begin, end] = sub_block(j);
+                for (size_t i = begin; i < end; i++) {
+                  sub_counts[local[i] * num_sub_blocks + j]++;
+                }
+              },
+              1);
+          parlay::scan_inplace(sub_counts);
+          parlay::parallel_for(0, size, [&](size_t u) {
+            offsets[first + u] = range_start + sub_counts[u * num_sub_blocks];
+          });
+          parlay::parallel_for(
+              0, num_sub_blocks,
+              [&](size_t j) {
+                auto [begin, end] = sub_block(j);
+                for (size_t i = begin; i < end; i++) {
+                  EdgeId &slot = sub_counts[local[i] * num_sub_blocks + j];
+                  edges[range_start + slot] = grouped[i];
+                  slot++;
+                }
+              },
+              1);
+          return;
+        }
+        EdgeId *degree = offsets.begin() + first;
+        for (size_t i = range_start; i < range_end; i++) {
+          degree[local[i]]++;
+        }
+        // degree[u] becomes the start of the list of u, and then its end
+        EdgeId start = range_start;
+        for (size_t u = 0; u < size; u++) {
+          EdgeId d = degree[u];
+          degree[u] = start;
+          start += d;
+        }
+        for (size_t i = range_start; i < range_end; i++) {
+          edges[degree[local[i]]++] = grouped[i];
+        }
+        for (size_t u = size - 1; u > 0; u--) {
+          degree[u] = degree[u - 1];
+        }
+        degree[0] = range_start;
+      },
+      1);
+  offsets[n] = m;
+  return {std::move(offsets), std::move(edges)};
+}
+
 template <class _NodeId = uint32_t, class _EdgeId = uint64_t,
           class _EdgeTy = Empty>
 class Graph {
@@ -63,10 +452,10 @@ class Graph {
   size_t m;
   bool symmetrized;
   bool weighted;
-  parlay::sequence<EdgeId> offsets;
-  parlay::sequence<Edge> edges;
-  parlay::sequence<EdgeId> in_offsets;
-  parlay::sequence<Edge> in_edges;
+  mmap_array<EdgeId> offsets;
+  mmap_array<Edge> edges;
+  mmap_array<EdgeId> in_offsets;
+  mmap_array<Edge> in_edges;
 
   Graph() {
     n = m = 0;
@@ -81,115 +470,467 @@ class Graph {
     }
   }
 
+  // Neighbor iteration interface. Algorithms that only use the functions
+  // below also run on CompressedGraph (see compressed_graph.h). They call
+  // f(v, w) for the neighbors v of u, where w is the weight of the edge.
+  size_t degree(NodeId u) const { return offsets[u + 1] - offsets[u]; }
+
+  size_t in_degree(NodeId u) const {
+    if (symmetrized) {
+      return degree(u);
+    } else {
+      return in_offsets[u + 1] - in_offsets[u];
+    }
+  }
+
+  // The ids of the neighbors of u, for unweighted graphs whose edges are
+  // stored as plain ids. Dense rounds scan them with the kernels in
+  // neighbor_scan.h.
+  auto neighbor_ids(NodeId u) const
+    requires(sizeof(Edge) == sizeof(NodeId))
+  {
+    const NodeId *ids = reinterpret_cast<const NodeId *>(edges.begin());
+    return parlay::make_slice(ids + offsets[u], ids + offsets[u + 1]);
+  }
+
+  auto in_neighbor_ids(NodeId u) const
+    requires(sizeof(Edge) == sizeof(NodeId))
+  {
+    const auto neighbors = in_neighors(u);
+    const NodeId *ids = reinterpret_cast<const NodeId *>(neighbors.begin());
+    return parlay::make_slice(ids, ids + neighbors.size());
+  }
+
+  template <class F>
+  void map_neighbors(NodeId u, F &&f) const {
+    for (EdgeId i = offsets[u]; i < offsets[u + 1]; i++) {
+      f(edges[i].v, edges[i].w);
+    }
+  }
+
+  // Stops as soon as f returns true
+  template <class F>
+  void map_neighbors_until(NodeId u, F &&f) const {
+    for (EdgeId i = offsets[u]; i < offsets[u + 1]; i++) {
+      if (f(edges[i].v, edges[i].w)) {
+        return;
+      }
+    }
+  }
+
+  // Stops as soon as f returns true
+  template <class F>
+  void map_in_neighbors_until(NodeId u, F &&f) const {
+    const auto neighbors = in_neighors(u);
+    for (size_t j = 0; j < neighbors.size(); j++) {
+      if (f(neighbors[j].v, neighbors[j].w)) {
+        return;
+      }
+    }
+  }
+
+  // Splits the neighbors of u into blocks of about block_size edges and calls
+  // g(map_block) on the blocks in parallel, where map_block(f) applies f to
+  // the neighbors in the block
+  template <class G>
+  void map_neighbor_blocks(NodeId u, size_t block_size, G &&g) const {
+    parlay::blocked_for(offsets[u], offsets[u + 1], block_size,
+                        [&](size_t, size_t start, size_t end) {
+                          g([&](auto &&f) {
+                            for (EdgeId i = start; i < end; i++) {
+                              f(edges[i].v, edges[i].w);
+                            }
+                          });
+                        });
+  }
+
+  // Same for the in-neighbors of u
+  template <class G>
+  void map_in_neighbor_blocks(NodeId u, size_t block_size, G &&g) const {
+    const auto neighbors = in_neighors(u);
+    parlay::blocked_for(0, neighbors.size(), block_size,
+                        [&](size_t, size_t start, size_t end) {
+                          g([&](auto &&f) {
+                            for (size_t j = start; j < end; j++) {
+                              f(neighbors[j].v, neighbors[j].w);
+                            }
+                          });
+                        });
+  }
+
+  template <class F>
+  void map_neighbors_parallel(NodeId u, F &&f, size_t block_size) const {
+    parlay::parallel_for(
+        offsets[u], offsets[u + 1],
+        [&](size_t i) { f(edges[i].v, edges[i].w); }, block_size);
+  }
+
+  template <class F>
+  void map_in_neighbors_parallel(NodeId u, F &&f, size_t block_size) const {
+    const auto neighbors = in_neighors(u);
+    parlay::parallel_for(
+        0, neighbors.size(),
+        [&](size_t j) { f(neighbors[j].v, neighbors[j].w); }, block_size);
+  }
+
   void make_inverse() {
-    parlay::sequence<std::pair<NodeId, Edge>> edgelist(m);
-    parlay::parallel_for(0, n, [&](NodeId u) {
-      parlay::parallel_for(offsets[u], offsets[u + 1], [&](EdgeId i) {
-        edgelist[i] = std::make_pair(edges[i].v, Edge(u, edges[i].w));
-      });
+    std::tie(in_offsets, in_edges) =
+        csr_from_edges<EdgeId, Edge>(
+            n, m, [&](size_t begin, size_t end, auto &&f) {
+              for_csr_range(offsets, n, begin, end, [&](NodeId u, size_t i) {
+                f(edges[i].v, Edge(u, edges[i].w));
+              });
+            });
+  }
+
+  // Computes in_offsets and in_edges like make_inverse, but caches them in a
+  // sidecar file next to the input graph (see transpose_path). Later runs map
+  // the sidecar instead of recomputing the transpose, as long as it was built
+  // from the same graph.
+  void make_inverse(const char *filename) {
+    if (in_offsets.size() == n + 1) {
+      // The input file already contains the transpose
+      return;
+    }
+    std::string path = transpose_path(filename);
+    uint64_t hash = checksum();
+    if (read_transpose(path.c_str(), hash)) {
+      printf("Loaded transpose from %s\n", path.c_str());
+      return;
+    }
+    make_inverse();
+    write_transpose(path.c_str(), hash);
+  }
+
+  // Position-dependent checksum of the offsets, edges and weights
+  uint64_t checksum() const {
+    auto offsets_hash = parlay::delayed_seq<uint64_t>(n + 1, [&](size_t i) {
+      return parlay::hash64(parlay::hash64(i) ^ offsets[i]);
     });
-    parlay::sort_inplace(
-        parlay::make_slice(edgelist),
-        [](const std::pair<NodeId, Edge> &a, const std::pair<NodeId, Edge> &b) {
-          if (a.first != b.first) {
-            return a.first < b.first;
-          }
-          return a.second.v < b.second.v;
-        });
-    in_offsets = parlay::sequence<EdgeId>(n + 1, m);
-    in_edges = parlay::sequence<Edge>(m);
-    parlay::parallel_for(0, m, [&](size_t i) {
-      in_edges[i] = edgelist[i].second;
-      if (i == 0 || edgelist[i].first != edgelist[i - 1].first) {
-        in_offsets[edgelist[i].first] = i;
+    auto edges_hash = parlay::delayed_seq<uint64_t>(m, [&](size_t i) {
+      uint64_t h = parlay::hash64(parlay::hash64(n + 1 + i) ^ edges[i].v);
+      if constexpr (!std::is_same_v<EdgeTy, Empty> && sizeof(EdgeTy) <= 8) {
+        if (weighted) {
+          uint64_t w = 0;
+          memcpy(&w, &edges[i].w, sizeof(EdgeTy));
+          h = parlay::hash64(h ^ w);
+        }
       }
+      return h;
     });
-    parlay::scan_inclusive_inplace(
-        parlay::make_slice(in_offsets.rbegin(), in_offsets.rend()),
-        parlay::minm<EdgeId>());
+    return parlay::reduce(offsets_hash) + parlay::reduce(edges_hash);
+  }
+
+  TransposeHeader transpose_header(uint64_t hash) const {
+    TransposeHeader header;
+    header.magic = TransposeHeader::MAGIC;
+    header.version = TransposeHeader::VERSION;
+    header.node_id_bytes = sizeof(NodeId);
+    header.edge_id_bytes = sizeof(EdgeId);
+    header.edge_bytes = sizeof(Edge);
+    header.weight_type =
+        std::is_same_v<EdgeTy, Empty> ? 0 : weight_type_code<EdgeTy>();
+    header.n = n;
+    header.m = m;
+    header.checksum = hash;
+    return header;
+  }
+
+  // Builds with other types store other arrays, so every layout has its own
+  // sidecar, filename.transpose.<vertex id bytes>-<edge id bytes>-<edge bytes>
+  // followed by the weight type code on weighted builds
+  std::string transpose_path(const char *filename) const {
+    TransposeHeader header = transpose_header(0);
+    std::string path = std::string(filename) + ".transpose." +
+                       std::to_string(header.node_id_bytes) + "-" +
+                       std::to_string(header.edge_id_bytes) + "-" +
+                       std::to_string(header.edge_bytes);
+    if (header.weight_type) {
+      path += static_cast<char>(header.weight_type);
+    }
+    return path;
+  }
+
+  bool read_transpose(const char *filename, uint64_t hash) {
+    if (access(filename, R_OK) != 0) {
+      return false;
+    }
+    auto file = std::make_shared<mapped_file>(filename);
+    TransposeHeader expected = transpose_header(hash);
+    if (file->size() != expected.file_size() ||
+        memcmp(file->data(), &expected, sizeof(TransposeHeader)) != 0) {
+      printf("Warning: ignoring stale transpose cache %s\n", filename);
+      return false;
+    }
+    in_offsets = mmap_array<EdgeId>(file, expected.in_offsets_pos(), n + 1);
+    in_edges = mmap_array<Edge>(file, expected.in_edges_pos(), m);
+    return true;
+  }
+
+  void write_transpose(const char *filename, uint64_t hash) {
+    // Every run writes its own temporary file and renames it over the cache
+    // once complete, so that concurrent runs never map a partial cache. The
+    // header goes last, so an incomplete file never has a valid one.
+    TransposeHeader header = transpose_header(hash);
+    output_file file;
+    if (!file.open_temporary(filename, header.file_size())) {
+      printf("Warning: cannot write transpose cache %s\n", filename);
+      return;
+    }
+    file.write_array(in_offsets.begin(), n + 1, header.in_offsets_pos());
+    file.write_array(in_edges.begin(), m, header.in_edges_pos());
+    file.write(&header, sizeof(TransposeHeader), 0);
+    if (!file.publish()) {
+      printf("Warning: cannot write transpose cache %s\n", filename);
+    }
   }
 
   void read_pbbs_format(char const *filename) {
-    auto chars = parlay::chars_from_file(std::string(filename));
-    auto tokens_seq = tokens(chars);
-    auto header = tokens_seq[0];
-    n = chars_to_ulong_long(tokens_seq[1]);
-    m = chars_to_ulong_long(tokens_seq[2]);
+    // Numbers are parsed in place from the mapped file in blocks of
+    // PARSE_BLOCK_SIZE bytes, and each number belongs to the block where it
+    // starts. A first pass counts the numbers in each block, so the second
+    // pass knows where to store them and the only extra memory is one counter
+    // per block.
+    constexpr size_t PARSE_BLOCK_SIZE = 1 << 20;
+    mapped_file file(filename);
+    const char *data = file.data();
+    size_t len = file.size();
+    auto is_space = [](char c) {
+      return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    };
+    size_t pos = 0;
+    auto next_token = [&]() {
+      while (pos < len && is_space(data[pos])) pos++;
+      size_t start = pos;
+      while (pos < len && !is_space(data[pos])) pos++;
+      return std::string_view(data + start, pos - start);
+    };
+    auto header = next_token();
+    n = parse_number<size_t>(next_token());
+    m = parse_number<size_t>(next_token());
     bool weighted_input;
-    if (header == parlay::to_chars("WeightedAdjacencyGraph")) {
+    if (header == "WeightedAdjacencyGraph") {
       weighted_input = true;
-      assert(tokens_seq.size() == n + m + m + 3);
-    } else if (header == parlay::to_chars("AdjacencyGraph")) {
+    } else if (header == "AdjacencyGraph") {
       weighted_input = false;
-      assert(tokens_seq.size() == n + m + 3);
     } else {
       std::cerr << "Unrecognized header" << std::endl;
       abort();
     }
-    offsets = parlay::sequence<EdgeId>(n + 1);
-    edges = parlay::sequence<Edge>(m);
-    parlay::parallel_for(0, n, [&](size_t i) {
-      offsets[i] = parlay::internal::chars_to_int_t<NodeId>(
-          make_slice(tokens_seq[i + 3]));
-    });
-    offsets[n] = m;
-    parlay::parallel_for(0, m, [&](size_t i) {
-      edges[i].v = parlay::internal::chars_to_int_t<NodeId>(
-          make_slice(tokens_seq[i + n + 3]));
-    });
+
+    size_t num_blocks = (len - pos + PARSE_BLOCK_SIZE - 1) / PARSE_BLOCK_SIZE;
+    auto block_offsets = parlay::sequence<size_t>(num_blocks + 1, 0);
+    auto token_start = [&](size_t i) {
+      return !is_space(data[i]) && is_space(data[i - 1]);
+    };
+    parlay::parallel_for(
+        0, num_blocks,
+        [&](size_t i) {
+          size_t start = pos + i * PARSE_BLOCK_SIZE;
+          size_t end = std::min(len, start + PARSE_BLOCK_SIZE);
+          size_t count = 0;
+          for (size_t j = start; j < end; j++) {
+            count += token_start(j);
+          }
+          block_offsets[i] = count;
+        },
+        1);
+    size_t num_tokens = parlay::scan_inplace(make_slice(block_offsets));
+    if (num_tokens != (weighted_input ? n + m + m : n + m)) {
+      std::cerr << "Error: Bad input graph" << std::endl;
+      abort();
+    }
+
+    auto _offsets = parlay::sequence<EdgeId>::uninitialized(n + 1);
+    auto _edges = parlay::sequence<Edge>::uninitialized(m);
+    parlay::parallel_for(
+        0, num_blocks,
+        [&](size_t i) {
+          size_t start = pos + i * PARSE_BLOCK_SIZE;
+          size_t end = std::min(len, start + PARSE_BLOCK_SIZE);
+          size_t k = block_offsets[i];
+          for (size_t j = start; j < end; j++) {
+            if (!token_start(j)) {
+              continue;
+            }
+            size_t token_end = j;
+            while (token_end < len && !is_space(data[token_end])) {
+              token_end++;
+            }
+            const char *first = data + j, *last = data + token_end;
+            if (k < n) {
+              _offsets[k] = parse_number<EdgeId>(first, last);
+            } else if (k < n + m) {
+              _edges[k - n].v = parse_number<NodeId>(first, last);
+            } else if constexpr (!std::is_same_v<EdgeTy, Empty>) {
+              _edges[k - n - m].w = parse_number<EdgeTy>(first, last);
+            }
+            k++;
+            j = token_end;
+          }
+        },
+        1);
+    _offsets[n] = m;
+    offsets = std::move(_offsets);
+    edges = std::move(_edges);
+
     if (weighted_input) {
       if constexpr (std::is_same_v<EdgeTy, Empty>) {
         weighted = false;
         std::cout << "Warning: skipping edge weights in file" << std::endl;
       } else {
         weighted = true;
-        parlay::parallel_for(0, m, [&](size_t i) {
-          if constexpr (std::is_integral_v<EdgeTy>) {
-            edges[i].w = parlay::internal::chars_to_int_t<NodeId>(
-                make_slice(tokens_seq[i + n + m + 3]));
-          } else if constexpr (std::is_floating_point_v<EdgeTy>) {
-            edges[i].w = parlay::chars_to_double(tokens_seq[i + n + m + 3]);
-          } else {
-            std::cerr << "Error: EdgeTy is not arithmetic" << std::endl;
+      }
+    } else {
+      weighted = false;
+    }
+  }
+
+  void read_pasgal_format(std::shared_ptr<mapped_file> file) {
+    BinaryHeader header;
+    memcpy(&header, file->data(), sizeof(BinaryHeader));
+    if (header.version != BinaryHeader::VERSION) {
+      std::cerr << "Error: Unsupported binary format version " << header.version
+                << std::endl;
+      abort();
+    }
+    auto valid_width = [](size_t bytes) {
+      return bytes == 1 || bytes == 2 || bytes == 4 || bytes == 8;
+    };
+    if (!valid_width(header.node_id_bytes) ||
+        !valid_width(header.edge_id_bytes) ||
+        (header.weight_bytes && !valid_width(header.weight_bytes)) ||
+        (header.weight_type == 'f' && header.weight_bytes != 4 &&
+         header.weight_bytes != 8)) {
+      std::cerr << "Error: Bad binary format header" << std::endl;
+      abort();
+    }
+    n = header.n;
+    m = header.m;
+    if (header.sizes != file->size() || header.file_size() != file->size()) {
+      std::cerr << "Error: Bad input graph" << std::endl;
+      abort();
+    }
+    if (n > std::numeric_limits<NodeId>::max() ||
+        m > std::numeric_limits<EdgeId>::max()) {
+      std::cerr << "Error: Graph is too large for NodeId/EdgeId" << std::endl;
+      abort();
+    }
+    const char *data = file->data();
+    if (header.edge_id_bytes == sizeof(EdgeId)) {
+      offsets = mmap_array<EdgeId>(file, header.offsets_pos(), n + 1);
+    } else {
+      offsets = parlay::tabulate(n + 1, [&](size_t i) {
+        return static_cast<EdgeId>(read_uint(data + header.offsets_pos(),
+                                             header.edge_id_bytes, i));
+      });
+    }
+    // Edges are used in place only if they hold nothing but targets as wide
+    // as those in the file. Weights are stored in a separate section, so
+    // weighted edges are always converted into owned storage.
+    if (header.node_id_bytes == sizeof(NodeId) &&
+        sizeof(Edge) == sizeof(NodeId)) {
+      edges = mmap_array<Edge>(file, header.edges_pos(), m);
+    } else {
+      auto _edges = parlay::sequence<Edge>::uninitialized(m);
+      std::atomic<bool> lossy = false;
+      parlay::parallel_for(0, m, [&](size_t i) {
+        _edges[i].v = read_uint(data + header.edges_pos(),
+                                header.node_id_bytes, i);
+        if constexpr (!std::is_same_v<EdgeTy, Empty>) {
+          if (header.weight_bytes) {
+            _edges[i].w = read_weight<EdgeTy>(data + header.weights_pos(),
+                                              header, i, lossy);
+          }
+        }
+      });
+      if constexpr (!std::is_same_v<EdgeTy, Empty>) {
+        // Weights of another type are accepted only if every value converts
+        // exactly, e.g. small 32-bit weights in a WEIGHT16 build
+        if (header.weight_bytes &&
+            (header.weight_type != weight_type_code<EdgeTy>() ||
+             header.weight_bytes > sizeof(EdgeTy))) {
+          if (lossy) {
+            std::cerr << "Error: " << (int)header.weight_bytes << "-byte '"
+                      << header.weight_type
+                      << "' edge weights in file do not fit the "
+                      << sizeof(EdgeTy) << "-byte '"
+                      << weight_type_code<EdgeTy>()
+                      << "' weights of this build" << std::endl;
             abort();
           }
-        });
+          std::cout << "Warning: converting " << (int)header.weight_bytes
+                    << "-byte '" << header.weight_type
+                    << "' edge weights in file to " << sizeof(EdgeTy)
+                    << "-byte '" << weight_type_code<EdgeTy>() << "'"
+                    << std::endl;
+        }
+      }
+      edges = std::move(_edges);
+    }
+    if (header.weight_bytes) {
+      if constexpr (std::is_same_v<EdgeTy, Empty>) {
+        weighted = false;
+        std::cout << "Warning: skipping edge weights in file" << std::endl;
+      } else {
+        weighted = true;
       }
     } else {
       weighted = false;
     }
   }
 
-  void read_binary_format(char const *filename) {
-    // Uses mmap to accelerate reading
-    struct stat sb;
-    int fd = open(filename, O_RDONLY);
-    if (fd == -1) {
-      std::cerr << "Error: Cannot open file " << filename << std::endl;
-      abort();
+  // Width of the edge targets of a GBBS file, which is 4 bytes, or 8 bytes in
+  // the variant with 64-bit vertex ids
+  static size_t gbbs_target_bytes(size_t n, size_t m, size_t sizes) {
+    for (size_t bytes : {4, 8}) {
+      if (sizes == (n + 1) * 8 + m * bytes + 3 * 8) {
+        return bytes;
+      }
     }
-    if (fstat(fd, &sb) == -1) {
-      std::cerr << "Error: Unable to acquire file stat" << std::endl;
+    std::cerr << "Error: Bad input graph" << std::endl;
+    abort();
+  }
+
+  void check_vertex_count() const {
+    if (n > std::numeric_limits<NodeId>::max()) {
+      std::cerr << "Error: Graph is too large for NodeId" << std::endl;
       abort();
     }
-    char *data =
-        static_cast<char *>(mmap(0, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
-    size_t len = sb.st_size;
+  }
+
+  void read_binary_format(char const *filename) {
+    // Uses mmap to accelerate reading
+    auto file = std::make_shared<mapped_file>(filename);
+    char *data = file->data();
+    if (file->size() >= sizeof(BinaryHeader) &&
+        reinterpret_cast<uint64_t *>(data)[0] == BinaryHeader::MAGIC) {
+      read_pasgal_format(file);
+      return;
+    }
     n = reinterpret_cast<uint64_t *>(data)[0];
     m = reinterpret_cast<uint64_t *>(data)[1];
     size_t sizes = reinterpret_cast<uint64_t *>(data)[2];
-    assert(sizes == (n + 1) * 8 + m * 4 + 3 * 8);
-    offsets = parlay::sequence<EdgeId>::uninitialized(n + 1);
-    edges = parlay::sequence<Edge>::uninitialized(m);
-    parlay::parallel_for(0, n + 1, [&](size_t i) {
-      offsets[i] = reinterpret_cast<uint64_t *>(data + 3 * 8)[i];
-    });
-    parlay::parallel_for(0, m, [&](size_t i) {
-      edges[i].v = reinterpret_cast<uint32_t *>(data + 3 * 8 + (n + 1) * 8)[i];
-    });
-    if (data) {
-      const void *b = data;
-      munmap(const_cast<void *>(b), len);
+    size_t target_bytes = gbbs_target_bytes(n, m, sizes);
+    check_vertex_count();
+    if (sizeof(EdgeId) == sizeof(uint64_t) && sizeof(Edge) == sizeof(NodeId) &&
+        sizeof(NodeId) == target_bytes) {
+      // The on-disk layout matches the in-memory layout, so the arrays are
+      // used in place and only the pages touched by the algorithms are read
+      offsets = mmap_array<EdgeId>(file, 3 * 8, n + 1);
+      edges = mmap_array<Edge>(file, 3 * 8 + (n + 1) * 8, m);
+    } else {
+      auto _offsets = parlay::sequence<EdgeId>::uninitialized(n + 1);
+      auto _edges = parlay::sequence<Edge>::uninitialized(m);
+      parlay::parallel_for(0, n + 1, [&](size_t i) {
+        _offsets[i] = reinterpret_cast<uint64_t *>(data + 3 * 8)[i];
+      });
+      parlay::parallel_for(0, m, [&](size_t i) {
+        _edges[i].v =
+            read_uint(data + 3 * 8 + (n + 1) * 8, target_bytes, i);
+      });
+      offsets = std::move(_offsets);
+      edges = std::move(_edges);
     }
   }
 
@@ -199,24 +940,40 @@ class Graph {
       std::cerr << "Error: Cannot open file " << filename << std::endl;
       abort();
     }
-    size_t sizes;
-    ifs.read(reinterpret_cast<char *>(&n), sizeof(size_t));
-    ifs.read(reinterpret_cast<char *>(&m), sizeof(size_t));
-    ifs.read(reinterpret_cast<char *>(&sizes), sizeof(size_t));
-    assert(sizes == (n + 1) * 8 + m * 4 + 3 * 8);
-    offsets = parlay::sequence<EdgeId>::uninitialized(n + 1);
-    edges = parlay::sequence<Edge>::uninitialized(m);
-    ifs.read(reinterpret_cast<char *>(offsets.begin()), (n + 1) * 8);
-    ifs.read(reinterpret_cast<char *>(edges.begin()), m * 4);
-
-    ifs.read(reinterpret_cast<char *>(&n), sizeof(size_t));
-    ifs.read(reinterpret_cast<char *>(&m), sizeof(size_t));
-    ifs.read(reinterpret_cast<char *>(&sizes), sizeof(size_t));
-    in_offsets = parlay::sequence<EdgeId>::uninitialized(n + 1);
-    in_edges = parlay::sequence<Edge>::uninitialized(m);
-    ifs.read(reinterpret_cast<char *>(in_offsets.begin()), (n + 1) * 8);
-    ifs.read(reinterpret_cast<char *>(in_edges.begin()), m * 4);
-    if (ifs.peek() != EOF) {
+    // The file holds the out-CSR followed by the in-CSR, both in GBBS format
+    auto read_csr = [&](mmap_array<EdgeId> &_offsets,
+                        mmap_array<Edge> &_edges) {
+      size_t sizes;
+      ifs.read(reinterpret_cast<char *>(&n), sizeof(size_t));
+      ifs.read(reinterpret_cast<char *>(&m), sizeof(size_t));
+      ifs.read(reinterpret_cast<char *>(&sizes), sizeof(size_t));
+      size_t target_bytes = gbbs_target_bytes(n, m, sizes);
+      check_vertex_count();
+      auto offsets_seq = parlay::sequence<uint64_t>::uninitialized(n + 1);
+      ifs.read(reinterpret_cast<char *>(offsets_seq.begin()), (n + 1) * 8);
+      if constexpr (std::is_same_v<EdgeId, uint64_t>) {
+        _offsets = std::move(offsets_seq);
+      } else {
+        _offsets = parlay::tabulate(n + 1, [&](size_t i) {
+          return static_cast<EdgeId>(offsets_seq[i]);
+        });
+      }
+      auto edges_seq = parlay::sequence<Edge>::uninitialized(m);
+      if (sizeof(Edge) == sizeof(NodeId) && sizeof(NodeId) == target_bytes) {
+        ifs.read(reinterpret_cast<char *>(edges_seq.begin()),
+                 m * target_bytes);
+      } else {
+        auto targets = parlay::sequence<char>::uninitialized(m * target_bytes);
+        ifs.read(targets.begin(), m * target_bytes);
+        parlay::parallel_for(0, m, [&](size_t i) {
+          edges_seq[i].v = read_uint(targets.begin(), target_bytes, i);
+        });
+      }
+      _edges = std::move(edges_seq);
+    };
+    read_csr(offsets, edges);
+    read_csr(in_offsets, in_edges);
+    if (!ifs || ifs.peek() != EOF) {
       std::cerr << "Error: Bad input graph" << std::endl;
       abort();
     }
@@ -224,6 +981,8 @@ class Graph {
   }
 
   void read_graph(const char *filename) {
+    in_offsets = mmap_array<EdgeId>();
+    in_edges = mmap_array<Edge>();
     std::string str_filename(filename);
     if (str_filename.find("hyperlink2012.bin") != std::string::npos) {
       // hack for hyperlink2012
@@ -247,62 +1006,101 @@ class Graph {
   }
 
   void write_pbbs_format(char const *filename) {
-    parlay::chars chars;
+    std::string header;
+    size_t num_lines = n + m;
     if constexpr (std::is_same_v<EdgeTy, Empty>) {
-      chars.insert(chars.end(), parlay::to_chars("AdjacencyGraph\n"));
+      header = "AdjacencyGraph\n";
     } else {
-      chars.insert(chars.end(), parlay::to_chars("WeightedAdjacencyGraph\n"));
-    }
-    chars.insert(chars.end(), parlay::to_chars(std::to_string(n) + "\n"));
-    chars.insert(chars.end(), parlay::to_chars(std::to_string(m) + "\n"));
-    chars.insert(chars.end(),
-                 parlay::flatten(parlay::tabulate(n * 2, [&](size_t i) {
-                   if (i % 2 == 0) {
-                     return parlay::to_chars(offsets[i / 2]);
-                   } else {
-                     return parlay::to_chars('\n');
-                   }
-                 })));
-    chars.insert(chars.end(),
-                 parlay::flatten(parlay::tabulate(m * 2, [&](size_t i) {
-                   if (i % 2 == 0) {
-                     return parlay::to_chars(edges[i / 2].v);
-                   } else {
-                     return parlay::to_chars('\n');
-                   }
-                 })));
+      header = "WeightedAdjacencyGraph\n";
+      num_lines += m;
+    }
+    header += std::to_string(n) + "\n" + std::to_string(m) + "\n";
+    write_text_file(filename, header, num_lines,
+                    [&](size_t i, std::string &out) {
+                      if (i < n) {
+                        append_line(out, offsets[i]);
+                      } else if (i < n + m) {
+                        append_line(out, edges[i - n].v);
+                      } else {
+                        if constexpr (!std::is_same_v<EdgeTy, Empty>) {
+                          append_line(out, edges[i - n - m].w);
+                        }
+                      }
+                    });
+  }
+
+  // Writes the targets of all edges at offset of file, directly from the edge
+  // array when the edges are unweighted
+  void write_targets(output_file &file, size_t offset) const {
+    if constexpr (sizeof(Edge) == sizeof(NodeId)) {
+      file.write_array(reinterpret_cast<const NodeId *>(edges.begin()), m,
+                       offset);
+    } else {
+      file.write_tabulate<NodeId>(m, offset,
+                                  [&](size_t i) { return edges[i].v; });
+    }
+  }
+
+  void write_pasgal_format(char const *filename) {
+    BinaryHeader header;
+    header.magic = BinaryHeader::MAGIC;
+    header.version = BinaryHeader::VERSION;
+    header.node_id_bytes = sizeof(NodeId);
+    header.edge_id_bytes = sizeof(EdgeId);
+    header.weight_bytes = 0;
+    header.weight_type = weight_type_code<EdgeTy>();
     if constexpr (!std::is_same_v<EdgeTy, Empty>) {
-      chars.insert(chars.end(),
-                   parlay::flatten(parlay::tabulate(m * 2, [&](size_t i) {
-                     if (i % 2 == 0) {
-                       return parlay::to_chars(std::to_string(edges[i / 2].w));
-                     } else {
-                       return parlay::to_chars('\n');
-                     }
-                   })));
+      if (weighted) {
+        header.weight_bytes = sizeof(EdgeTy);
+      }
+    }
+    header.n = n;
+    header.m = m;
+    header.sizes = header.file_size();
+
+    output_file file;
+    if (!file.open(filename, header.file_size())) {
+      std::cerr << "Error: Cannot open file " << filename << std::endl;
+      abort();
+    }
+    file.write(&header, sizeof(BinaryHeader), 0);
+    file.write_array(offsets.begin(), n + 1, header.offsets_pos());
+    write_targets(file, header.edges_pos());
+    if constexpr (!std::is_same_v<EdgeTy, Empty>) {
+      if (weighted) {
+        file.write_tabulate<EdgeTy>(m, header.weights_pos(),
+                                    [&](size_t i) { return edges[i].w; });
+      }
+    }
+    if (!file.close()) {
+      std::cerr << "Error: Cannot write file " << filename << std::endl;
+      abort();
     }
-    chars_to_file(chars, std::string(filename));
   }
 
+  // Writes the GBBS format when it can represent the graph, and the PASGAL
+  // binary format for weighted graphs and graphs with 64-bit vertex ids
   void write_binary_format(char const *filename) {
-    assert(sizeof(EdgeId) == sizeof(uint64_t));
-    assert(sizeof(NodeId) == sizeof(uint32_t));
+    if (weighted || sizeof(NodeId) != sizeof(uint32_t) ||
+        sizeof(EdgeId) != sizeof(uint64_t)) {
+      write_pasgal_format(filename);
+      return;
+    }
     size_t sizes = (n + 1) * 8 + m * 4 + 3 * 8;
-    auto tmp_edges =
-        parlay::tabulate<NodeId>(m, [&](size_t i) { return edges[i].v; });
+    size_t header[3] = {n, m, sizes};
 
-    std::ofstream ofs(filename);
-    if (!ofs.is_open()) {
+    output_file file;
+    if (!file.open(filename, sizes)) {
       std::cerr << "Error: Cannot open file " << filename << std::endl;
       abort();
     }
-    ofs.write(reinterpret_cast<char *>(&n), sizeof(size_t));
-    ofs.write(reinterpret_cast<char *>(&m), sizeof(size_t));
-    ofs.write(reinterpret_cast<char *>(&sizes), sizeof(size_t));
-    ofs.write(reinterpret_cast<char *>(offsets.begin()),
-              sizeof(EdgeId) * (n + 1));
-    ofs.write(reinterpret_cast<char *>(tmp_edges.begin()), sizeof(NodeId) * m);
-    ofs.close();
+    file.write(header, sizeof(header), 0);
+    file.write_array(offsets.begin(), n + 1, sizeof(header));
+    write_targets(file, sizeof(header) + sizeof(EdgeId) * (n + 1));
+    if (!file.close()) {
+      std::cerr << "Error: Cannot write file " << filename << std::endl;
+      abort();
+    }
   }
 
   // Generates integral edge weights in range [l, r)
@@ -318,10 +1116,11 @@ class Graph {
       weighted = true;
     }
     uint32_t range = r - l + 1;
+    Edge *_edges = edges.mutable_data();
     parlay::parallel_for(0, n, [&](NodeId u) {
       parlay::parallel_for(offsets[u], offsets[u + 1], [&](EdgeId i) {
-        NodeId v = edges[i].v;
-        edges[i].w = ((parlay::hash32(u) ^ parlay::hash32(v)) % range) + l;
+        NodeId v = _edges[i].v;
+        _edges[i].w = ((parlay::hash32(u) ^ parlay::hash32(v)) % range) + l;
       });
     });
   }
@@ -419,17 +1218,19 @@ class Graph {
                            }
                            return a.second < b.second;
                          });
-    offsets = parlay::sequence<EdgeId>(n + 1, m);
-    edges = parlay::sequence<Edge>(m);
+    auto _offsets = parlay::sequence<EdgeId>(n + 1, m);
+    auto _edges = parlay::sequence<Edge>(m);
     parlay::parallel_for(0, m, [&](size_t i) {
-      edges[i].v = edgelist[i].second;
+      _edges[i].v = edgelist[i].second;
       if (i == 0 || edgelist[i].first != edgelist[i - 1].first) {
-        offsets[edgelist[i].first] = i;
+        _offsets[edgelist[i].first] = i;
       }
     });
     parlay::scan_inclusive_inplace(
-        parlay::make_slice(offsets.rbegin(), offsets.rend()),
+        parlay::make_slice(_offsets.rbegin(), _offsets.rend()),
         parlay::minm<EdgeId>());
+    offsets = std::move(_offsets);
+    edges = std::move(_edges);
   }
 };
 
@@ -450,25 +1251,13 @@ Graph<NodeId, EdgeId, EdgeTy> edgelist2graph(
   Graph<NodeId, EdgeId, EdgeTy> G;
   G.n = n;
   G.m = m;
-  parlay::sort_inplace(
-      parlay::make_slice(edgelist),
-      [](const std::pair<NodeId, Edge> &a, const std::pair<NodeId, Edge> &b) {
-        if (a.first != b.first) {
-          return a.first < b.first;
-        }
-        return a.second.v < b.second.v;
-      });
-  G.offsets = parlay::sequence<EdgeId>(n + 1, m);
-  G.edges = parlay::sequence<Edge>(m);
-  parlay::parallel_for(0, m, [&](size_t i) {
-    G.edges[i] = edgelist[i].second;
-    if (i == 0 || edgelist[i].first != edgelist[i - 1].first) {
-      G.offsets[edgelist[i].first] = i;
-    }
-  });
-  parlay::scan_inclusive_inplace(
-      parlay::make_slice(G.offsets.rbegin(), G.offsets.rend()),
-      parlay::minm<EdgeId>());
+  std::tie(G.offsets, G.edges) =
+      csr_from_edges<EdgeId, Edge>(
+          n, m, [&](size_t begin, size_t end, auto &&f) {
+            for (size_t i = begin; i < end; i++) {
+              f(edgelist[i].first, edgelist[i].second);
+            }
+          });
   return G;
 }
 
@@ -505,19 +1294,100 @@ Graph make_symmetrized(const Graph &G) {
 
 template <class Graph>
 Graph Transpose(const Graph &G) {
-  size_t n = G.n;
-  size_t m = G.m;
   using NodeId = typename Graph::NodeId;
   using EdgeId = typename Graph::EdgeId;
-  using EdgeTy = typename Graph::EdgeTy;
   using Edge = typename Graph::Edge;
-  parlay::sequence<std::pair<NodeId, Edge>> edgelist(m);
-  parlay::parallel_for(0, n, [&](NodeId u) {
-    parlay::parallel_for(G.offsets[u], G.offsets[u + 1], [&](EdgeId i) {
-      edgelist[i] = std::make_pair(G.edges[i].v, Edge(u, G.edges[i].w));
-    });
-  });
-  return edgelist2graph<NodeId, EdgeId, EdgeTy>(edgelist, n, m);
+  Graph GT;
+  GT.n = G.n;
+  GT.m = G.m;
+  std::tie(GT.offsets, GT.edges) =
+      csr_from_edges<EdgeId, Edge>(
+          G.n, G.m, [&](size_t begin, size_t end, auto &&f) {
+            for_csr_range(G.offsets, G.n, begin, end, [&](NodeId u, size_t i) {
+              f(G.edges[i].v, Edge(u, G.edges[i].w));
+            });
+          });
+  return GT;
 }
 
+// Same as Transpose, but uses the transpose cache of the input file (see
+// Graph::make_inverse). The in-CSR of G is moved into the result.
+template <class Graph>
+Graph Transpose(Graph &G, const char *filename) {
+  G.make_inverse(filename);
+  Graph GT;
+  GT.n = G.n;
+  GT.m = G.m;
+  GT.weighted = G.weighted;
+  GT.offsets = std::move(G.in_offsets);
+  GT.edges = std::move(G.in_edges);
+  return GT;
+}
+
+// The transpose of a graph as a view: the neighbor iteration interface of
+// Graph or CompressedGraph with out- and in-neighbors swapped, so that a BFS
+// on it follows the edges of G backward without copying them. Directed graphs
+// need their in-CSR.
+template <class Graph>
+class TransposedGraph {
+ public:
+  using NodeId = typename Graph::NodeId;
+  using EdgeId = typename Graph::EdgeId;
+  using EdgeTy = typename Graph::EdgeTy;
+
+  const Graph &G;
+  size_t n;
+  size_t m;
+  bool symmetrized;
+  bool weighted;
+
+  TransposedGraph(const Graph &_G)
+      : G(_G),
+        n(_G.n),
+        m(_G.m),
+        symmetrized(_G.symmetrized),
+        weighted(_G.weighted) {}
+
+  size_t degree(NodeId u) const { return G.in_degree(u); }
+  size_t in_degree(NodeId u) const { return G.degree(u); }
+
+  template <class F>
+  void map_neighbors(NodeId u, F &&f) const {
+    G.map_in_neighbors_until(u, [&](NodeId v, auto w) {
+      f(v, w);
+      return false;
+    });
+  }
+
+  template <class F>
+  void map_neighbors_until(NodeId u, F &&f) const {
+    G.map_in_neighbors_until(u, f);
+  }
+
+  template <class F>
+  void map_in_neighbors_until(NodeId u, F &&f) const {
+    G.map_neighbors_until(u, f);
+  }
+
+  template <class H>
+  void map_neighbor_blocks(NodeId u, size_t block_size, H &&g) const {
+    G.map_in_neighbor_blocks(u, block_size, g);
+  }
+
+  template <class H>
+  void map_in_neighbor_blocks(NodeId u, size_t block_size, H &&g) const {
+    G.map_neighbor_blocks(u, block_size, g);
+  }
+
+  template <class F>
+  void map_neighbors_parallel(NodeId u, F &&f, size_t block_size) const {
+    G.map_in_neighbors_parallel(u, f, block_size);
+  }
+
+  template <class F>
+  void map_in_neighbors_parallel(NodeId u, F &&f, size_t block_size) const {
+    G.map_neighbors_parallel(u, f, block_size);
+  }
+};
+
 #endif  // GRAPH_H
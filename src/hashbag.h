@@ -2,7 +2,9 @@
 #ifndef HASHBAG_H
 #define HASHBAG_H
 
+#include <algorithm>
 #include <atomic>
+#include <limits>
 
 #include "parlay/delayed_sequence.h"
 #include "parlay/primitives.h"
@@ -18,21 +20,47 @@ class hashbag {
   static constexpr size_t OVER_SAMPLING = 4;
 
   size_t n;
+  double load_factor;
   const ET empty;
   std::atomic<uint32_t> bag_id;
+  // Only the sub-bags [0, num_allocated) have room in pool. Inserts that find
+  // no room in them are dropped, which sets overflow.
+  size_t num_allocated;
+  std::atomic<bool> overflow;
 
   parlay::sequence<size_t> bag_sizes;
   parlay::sequence<size_t> offsets;
   parlay::sequence<Sampler> samplers;
   parlay::sequence<ET> pool;
 
+  bool full() {
+    if (num_allocated == bag_sizes.size()) {
+      printf("hashbag is full\n");
+      assert(false);
+    }
+    overflow = true;
+    return false;
+  }
+
+  size_t used_size() const {
+    if (num_allocated == 0) {
+      return 0;
+    }
+    size_t last = std::min<size_t>(bag_id, num_allocated - 1);
+    return offsets[last] + bag_sizes[last];
+  }
+
  public:
   hashbag() = default;
 
-  hashbag(size_t _n, double load_factor = 0.5,
-          const ET _empty = std::numeric_limits<ET>::max())
-      : n(_n), empty(_empty) {
+  // Holds up to n elements. With a capacity, only room for about that many
+  // elements is allocated, and reserve() makes room for more.
+  hashbag(size_t _n, double _load_factor = 0.5,
+          const ET _empty = std::numeric_limits<ET>::max(),
+          size_t capacity = std::numeric_limits<size_t>::max())
+      : n(_n), load_factor(_load_factor), empty(_empty) {
     bag_id = 0;
+    overflow = false;
     size_t cur_size = MIN_BAG_SIZE;
     size_t total_size = 0;
     for (size_t i = 0; total_size * load_factor < n; i++) {
@@ -44,13 +72,17 @@ class hashbag {
       total_size += cur_size;
       cur_size *= 2;
     }
-    pool = parlay::sequence<ET>(total_size, empty);
+    num_allocated = 0;
+    reserve(capacity);
   }
 
   hashbag(const hashbag &other)
       : n(other.n),
+        load_factor(other.load_factor),
         empty(other.empty),
         bag_id(other.bag_id.load()),
+        num_allocated(other.num_allocated),
+        overflow(other.overflow.load()),
         bag_sizes(other.bag_sizes),
         offsets(other.offsets),
         samplers(other.samplers),
@@ -58,29 +90,70 @@ class hashbag {
 
   hashbag(hashbag &&other)
       : n(other.n),
+        load_factor(other.load_factor),
         empty(other.empty),
         bag_id(other.bag_id.load()),
+        num_allocated(other.num_allocated),
+        overflow(other.overflow.load()),
         bag_sizes(other.bag_sizes),
         offsets(other.offsets),
         samplers(other.samplers),
         pool(other.pool) {}
 
+  // Number of pool slots needed for about k elements
+  size_t capacity_for(size_t k) const {
+    if (bag_sizes.empty()) {
+      return 0;
+    }
+    size_t i = 0;
+    while (i + 1 < bag_sizes.size() &&
+           (offsets[i] + bag_sizes[i]) * load_factor < k) {
+      i++;
+    }
+    return offsets[i] + bag_sizes[i];
+  }
+
+  // Makes room for about k elements, keeping the elements in the bag
+  void reserve(size_t k) {
+    size_t total_size = capacity_for(k);
+    if (total_size <= pool.size()) {
+      return;
+    }
+    auto new_pool = parlay::sequence<ET>(total_size, empty);
+    parlay::parallel_for(
+        0, pool.size(), [&](size_t i) { new_pool[i] = pool[i]; }, BLOCK_SIZE);
+    pool = std::move(new_pool);
+    while (num_allocated < bag_sizes.size() &&
+           offsets[num_allocated] + bag_sizes[num_allocated] <= total_size) {
+      num_allocated++;
+    }
+  }
+
+  size_t size_in_bytes() const { return pool.size() * sizeof(ET); }
+
+  // Whether inserts were dropped since the last clear
+  bool overflowed() const { return overflow; }
+
   void clear() {
-    for (size_t i = 0; i <= bag_id; i++) {
+    for (size_t i = 0; i <= bag_id && i < num_allocated; i++) {
       samplers[i].reset();
     }
     parlay::parallel_for(
-        0, offsets[bag_id] + bag_sizes[bag_id],
-        [&](size_t i) { pool[i] = empty; }, BLOCK_SIZE);
+        0, used_size(), [&](size_t i) { pool[i] = empty; }, BLOCK_SIZE);
     bag_id = 0;
+    overflow = false;
   }
 
-  void insert(ET u) {
+  // Returns false if u was dropped for lack of room
+  bool insert(ET u) {
     uint32_t local_id = bag_id;
+    if (local_id >= num_allocated) {
+      return full();
+    }
     auto random_number = parlay::hash32(u);
     size_t idx = random_number & (bag_sizes[local_id] - 1);
     bool callback = false;
-    while (local_id + 1 < bag_sizes.size() &&
+    while (local_id + 1 < num_allocated &&
            !samplers[local_id].sample(random_number, callback)) {
       local_id++;
     }
@@ -97,18 +170,18 @@ class hashbag {
       num_probes++;
       if (num_probes == bag_sizes[local_id]) {
         local_id++;
-        if (local_id >= bag_sizes.size()) {
-          printf("hashbag is full\n");
-          assert(false);
+        if (local_id >= num_allocated) {
+          return full();
         }
         idx = random_number & (bag_sizes[local_id] - 1);
       }
     }
+    return true;
   }
 
   template <typename Seq>
   size_t pack_into(Seq &&out) {
-    size_t len = offsets[bag_id] + bag_sizes[bag_id];
+    size_t len = used_size();
     auto pred = parlay::delayed_seq<bool>(
         len, [&](size_t i) { return pool[i] != empty; });
     size_t num_records = parlay::pack_into_uninitialized(pool.cut(0, len), pred,
@@ -117,8 +190,16 @@ class hashbag {
     return num_records;
   }
 
+  // The elements of the bag in a sequence of their size
+  parlay::sequence<ET> pack() {
+    auto ret = parlay::filter(pool.cut(0, used_size()),
+                              [&](ET x) { return x != empty; });
+    clear();
+    return ret;
+  }
+
   void print() {
-    for (size_t i = 0; i <= bag_id; i++) {
+    for (size_t i = 0; i <= bag_id && i < num_allocated; i++) {
       auto seq = parlay::delayed_seq<uint32_t>(bag_sizes[i], [&](size_t j) {
         return pool[j + offsets[i]] != empty;
       });
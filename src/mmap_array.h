@@ -0,0 +1,292 @@
+#ifndef MMAP_ARRAY_H
+#define MMAP_ARRAY_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "parlay/parallel.h"
+#include "parlay/sequence.h"
+#include "parlay/slice.h"
+
+// A read-only memory mapping of a whole file. Pages are loaded lazily on first
+// access and the mapping is released together with the last reference to it.
+class mapped_file {
+  char *data_;
+  size_t size_;
+
+ public:
+  explicit mapped_file(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+      std::cerr << "Error: Cannot open file " << filename << std::endl;
+      abort();
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+      std::cerr << "Error: Unable to acquire file stat" << std::endl;
+      abort();
+    }
+    size_ = sb.st_size;
+    void *addr = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      std::cerr << "Error: Unable to mmap file " << filename << std::endl;
+      abort();
+    }
+    data_ = static_cast<char *>(addr);
+    close(fd);
+  }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() { munmap(data_, size_); }
+
+  char *data() const { return data_; }
+  size_t size() const { return size_; }
+};
+
+// A file of known size that is written concurrently with pwrite at precomputed
+// offsets, so that writers stream their arrays in parallel blocks without
+// building the file contents in memory. The file is created with its final
+// size and ranges that are never written read as zeros. Write errors are
+// recorded and reported by close().
+//
+// A cache that other runs may map is written with open_temporary() and
+// publish() instead: every writer fills its own file in the same directory,
+// which is renamed over the cache only once it is complete.
+class output_file {
+  int fd;
+  std::atomic<bool> ok;
+  std::string temporary_path;
+  std::string final_path;
+
+ public:
+  // Bytes written by one task
+  static constexpr size_t BLOCK_SIZE = 1 << 22;
+
+  output_file() : fd(-1), ok(false) {}
+
+  output_file(const output_file &) = delete;
+  output_file &operator=(const output_file &) = delete;
+
+  ~output_file() {
+    close();
+    discard_temporary();
+  }
+
+  // Creates or truncates filename to size bytes, and returns whether it
+  // succeeded
+  bool open(const char *filename, size_t size) {
+    close();
+    fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+      return false;
+    }
+    ok = ftruncate(fd, size) == 0;
+    return ok;
+  }
+
+  // Creates a file of size bytes with a unique name next to filename, to be
+  // renamed to filename by publish(), and returns whether it succeeded
+  bool open_temporary(const char *filename, size_t size) {
+    close();
+    discard_temporary();
+    std::string path = std::string(filename) + ".XXXXXX";
+    fd = mkstemp(path.data());
+    if (fd == -1) {
+      return false;
+    }
+    temporary_path = path;
+    final_path = filename;
+    ok = fchmod(fd, 0644) == 0 && ftruncate(fd, size) == 0;
+    return ok;
+  }
+
+  // Closes the file opened by open_temporary and renames it to its final
+  // name, and returns whether every step succeeded. The file is removed if
+  // any step failed.
+  bool publish() {
+    bool success = close() && !temporary_path.empty() &&
+                   rename(temporary_path.c_str(), final_path.c_str()) == 0;
+    if (success) {
+      temporary_path.clear();
+    }
+    discard_temporary();
+    return success;
+  }
+
+  // Writes bytes from data at offset of the file
+  void write(const void *data, size_t bytes, size_t offset) {
+    const char *p = static_cast<const char *>(data);
+    while (bytes > 0) {
+      ssize_t written = pwrite(fd, p, bytes, offset);
+      if (written == -1 && errno == EINTR) {
+        continue;
+      }
+      if (written <= 0) {
+        ok = false;
+        return;
+      }
+      p += written;
+      bytes -= written;
+      offset += written;
+    }
+  }
+
+  // Writes n elements of T from data at offset of the file in parallel
+  template <class T>
+  void write_array(const T *data, size_t n, size_t offset) {
+    size_t bytes = n * sizeof(T);
+    size_t num_blocks = (bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    parlay::parallel_for(
+        0, num_blocks,
+        [&](size_t i) {
+          size_t start = i * BLOCK_SIZE;
+          size_t end = std::min(start + BLOCK_SIZE, bytes);
+          write(reinterpret_cast<const char *>(data) + start, end - start,
+                offset + start);
+        },
+        1);
+  }
+
+  // Writes the n elements f(0), ..., f(n - 1) of type T at offset of the
+  // file. Each task converts one block into a buffer of BLOCK_SIZE bytes, so
+  // the elements are never materialized all at once.
+  template <class T, class F>
+  void write_tabulate(size_t n, size_t offset, F &&f) {
+    constexpr size_t block_elements =
+        std::max(BLOCK_SIZE / sizeof(T), size_t{1});
+    size_t num_blocks = (n + block_elements - 1) / block_elements;
+    parlay::parallel_for(
+        0, num_blocks,
+        [&](size_t i) {
+          size_t start = i * block_elements;
+          size_t end = std::min(start + block_elements, n);
+          auto buffer = parlay::sequence<T>::uninitialized(end - start);
+          for (size_t j = start; j < end; j++) {
+            buffer[j - start] = f(j);
+          }
+          write(buffer.begin(), (end - start) * sizeof(T),
+                offset + start * sizeof(T));
+        },
+        1);
+  }
+
+  // Closes the file, and returns whether it was opened and every write
+  // succeeded
+  bool close() {
+    if (fd == -1) {
+      return false;
+    }
+    bool success = ok && ::close(fd) == 0;
+    fd = -1;
+    ok = false;
+    return success;
+  }
+
+ private:
+  void discard_temporary() {
+    if (!temporary_path.empty()) {
+      unlink(temporary_path.c_str());
+      temporary_path.clear();
+    }
+  }
+};
+
+// Array of T that either owns its elements in a parlay::sequence, or refers to
+// a range of a mapped_file without copying it. It provides the subset of the
+// parlay::sequence interface used on graph arrays, so algorithms access both
+// kinds of storage in the same way. Elements are written only through
+// mutable_data(), which copies a mapped array first; copies of a mapped array
+// share the mapping.
+template <class T>
+class mmap_array {
+  parlay::sequence<T> seq;
+  std::shared_ptr<mapped_file> file;
+  T *ptr;
+  size_t len;
+
+ public:
+  using value_type = T;
+  using iterator = const T *;
+  using const_iterator = const T *;
+
+  mmap_array() : ptr(nullptr), len(0) {}
+
+  mmap_array(parlay::sequence<T> _seq)
+      : seq(std::move(_seq)), ptr(seq.begin()), len(seq.size()) {}
+
+  // Refers to n elements of type T starting at byte offset of the file
+  mmap_array(std::shared_ptr<mapped_file> _file, size_t offset, size_t n)
+      : file(std::move(_file)),
+        ptr(reinterpret_cast<T *>(file->data() + offset)),
+        len(n) {}
+
+  mmap_array(const mmap_array &other)
+      : seq(other.seq),
+        file(other.file),
+        ptr(file ? other.ptr : seq.begin()),
+        len(other.len) {}
+
+  mmap_array(mmap_array &&other)
+      : seq(std::move(other.seq)),
+        file(std::move(other.file)),
+        ptr(file ? other.ptr : seq.begin()),
+        len(other.len) {
+    other.ptr = nullptr;
+    other.len = 0;
+  }
+
+  mmap_array &operator=(mmap_array other) {
+    // parlay::sequence may store small arrays inline, so ptr is recomputed
+    // after the storage is moved
+    seq = std::move(other.seq);
+    file = std::move(other.file);
+    ptr = file ? other.ptr : seq.begin();
+    len = other.len;
+    return *this;
+  }
+
+  bool is_mapped() const { return file != nullptr; }
+
+  size_t size() const { return len; }
+
+  // Elements are only read through the array, mapped or not, so a write to
+  // a mapping fails to compile instead of faulting at run time
+  const T &operator[](size_t i) const { return ptr[i]; }
+
+  const T *begin() const { return ptr; }
+  const T *end() const { return ptr + len; }
+
+  // Pointer to the elements for writing. A mapped array is first copied
+  // into owned storage, which leaves copies of it on the mapping. This is
+  // done by the calling thread, so call it before parallel writes.
+  T *mutable_data() {
+    if (file) {
+      seq = parlay::sequence<T>(begin(), end());
+      file = nullptr;
+      ptr = seq.begin();
+    }
+    return ptr;
+  }
+
+  auto cut(size_t l, size_t r) const {
+    return parlay::make_slice(static_cast<const T *>(ptr + l),
+                              static_cast<const T *>(ptr + r));
+  }
+};
+
+#endif  // MMAP_ARRAY_H
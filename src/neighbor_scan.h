@@ -0,0 +1,206 @@
+#ifndef NEIGHBOR_SCAN_H
+#define NEIGHBOR_SCAN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "bitmap.h"
+
+// Bottom-up (dense) rounds scan the in-neighbors of every unvisited vertex
+// until one of them is in the frontier. When a graph stores its neighbors as
+// plain arrays of 32-bit ids (unweighted Graph, see Graph::neighbor_ids), the
+// helpers below check 16 (AVX-512) or 8 (AVX2) neighbors at a time by
+// gathering their frontier bits or distances, and find the first hit with a
+// bit scan. The kernel is chosen at build time from the target (the Makefiles
+// build with -march=native). Other targets, id widths and graphs, such as
+// CompressedGraph or weighted graphs, use the scalar loop.
+//
+// The AVX-512 kernels use the masked forms of the intrinsics with a zero
+// source and a full mask. The unmasked forms pass an undefined source to the
+// builtins, for which GCC 12 raises -Wmaybe-uninitialized in its headers.
+
+// Index of the first ids[i], begin <= i < end, that is in set, or end
+template <class NodeId>
+size_t find_first_in(const bitmap &set, const NodeId *ids, size_t begin,
+                     size_t end) {
+  size_t i = begin;
+#if defined(__AVX2__)
+  if constexpr (sizeof(NodeId) == 4) {
+    // Vertex v is bit v % 32 of the 32-bit word v / 32 on little-endian
+    // targets
+    const int *words = reinterpret_cast<const int *>(set.data());
+#if defined(__AVX512F__)
+    const __mmask16 all = 0xffff;
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i low = _mm512_set1_epi32(31);
+    const __m512i one = _mm512_set1_epi32(1);
+    for (; i + 16 <= end; i += 16) {
+      __m512i v = _mm512_loadu_si512(ids + i);
+      __m512i w = _mm512_mask_i32gather_epi32(
+          zero, all, _mm512_maskz_srli_epi32(all, v, 5), words, 4);
+      __m512i bits =
+          _mm512_maskz_srlv_epi32(all, w, _mm512_and_si512(v, low));
+      __mmask16 hits = _mm512_test_epi32_mask(bits, one);
+      if (hits) {
+        return i + __builtin_ctz(hits);
+      }
+    }
+#else
+    const __m256i low = _mm256_set1_epi32(31);
+    const __m256i one = _mm256_set1_epi32(1);
+    for (; i + 8 <= end; i += 8) {
+      __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ids + i));
+      __m256i w = _mm256_i32gather_epi32(words, _mm256_srli_epi32(v, 5), 4);
+      __m256i bits = _mm256_and_si256(
+          _mm256_srlv_epi32(w, _mm256_and_si256(v, low)), one);
+      int hits = _mm256_movemask_ps(
+          _mm256_castsi256_ps(_mm256_cmpeq_epi32(bits, one)));
+      if (hits) {
+        return i + __builtin_ctz(hits);
+      }
+    }
+#endif
+  }
+#endif
+  for (; i < end; i++) {
+    if (set.get(ids[i])) {
+      return i;
+    }
+  }
+  return end;
+}
+
+// Index of the first ids[i], begin <= i < end, with values[ids[i]] < bound,
+// or end. values has n elements.
+template <class NodeId, class T>
+size_t find_first_below([[maybe_unused]] const T *values,
+                        [[maybe_unused]] size_t n, const NodeId *ids,
+                        size_t begin, size_t end, T bound) {
+  size_t i = begin;
+#if defined(__AVX2__)
+  // Gathers take signed 32-bit indices
+  if constexpr (sizeof(NodeId) == 4 && sizeof(T) == 4 &&
+                std::is_unsigned_v<T>) {
+    if (n <= (size_t)std::numeric_limits<int32_t>::max() && bound > 0) {
+      const int *vals = reinterpret_cast<const int *>(values);
+#if defined(__AVX512F__)
+      const __mmask16 all = 0xffff;
+      const __m512i zero = _mm512_setzero_si512();
+      const __m512i b = _mm512_set1_epi32(bound);
+      for (; i + 16 <= end; i += 16) {
+        __m512i v = _mm512_loadu_si512(ids + i);
+        __m512i x = _mm512_mask_i32gather_epi32(zero, all, v, vals, 4);
+        __mmask16 hits = _mm512_cmplt_epu32_mask(x, b);
+        if (hits) {
+          return i + __builtin_ctz(hits);
+        }
+      }
+#else
+      // x < bound if min(x, bound - 1) == x
+      const __m256i b = _mm256_set1_epi32(bound - 1);
+      for (; i + 8 <= end; i += 8) {
+        __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ids + i));
+        __m256i x = _mm256_i32gather_epi32(vals, v, 4);
+        int hits = _mm256_movemask_ps(_mm256_castsi256_ps(
+            _mm256_cmpeq_epi32(_mm256_min_epu32(x, b), x)));
+        if (hits) {
+          return i + __builtin_ctz(hits);
+        }
+      }
+#endif
+    }
+  }
+#endif
+  for (; i < end; i++) {
+    if (values[ids[i]] < bound) {
+      return i;
+    }
+  }
+  return end;
+}
+
+template <class Graph, class NodeId = typename Graph::NodeId>
+constexpr bool has_neighbor_ids =
+    requires(const Graph &G, NodeId u) { G.neighbor_ids(u); };
+
+// Calls f(v) on the neighbors v of u that are in set, in order, until f
+// returns true
+template <class Graph, class F, class NodeId = typename Graph::NodeId>
+void scan_neighbors_in(const Graph &G, NodeId u, const bitmap &set, F &&f) {
+  if constexpr (has_neighbor_ids<Graph>) {
+    auto ids = G.neighbor_ids(u);
+    for (size_t i = find_first_in(set, ids.begin(), 0, ids.size());
+         i < ids.size() && !f(ids[i]);
+         i = find_first_in(set, ids.begin(), i + 1, ids.size())) {
+    }
+  } else {
+    G.map_neighbors_until(
+        u, [&](NodeId v, auto) { return set.get(v) && f(v); });
+  }
+}
+
+// Same for the in-neighbors of u
+template <class Graph, class F, class NodeId = typename Graph::NodeId>
+void scan_in_neighbors_in(const Graph &G, NodeId u, const bitmap &set,
+                          F &&f) {
+  if constexpr (has_neighbor_ids<Graph>) {
+    auto ids = G.in_neighbor_ids(u);
+    for (size_t i = find_first_in(set, ids.begin(), 0, ids.size());
+         i < ids.size() && !f(ids[i]);
+         i = find_first_in(set, ids.begin(), i + 1, ids.size())) {
+    }
+  } else {
+    G.map_in_neighbors_until(
+        u, [&](NodeId v, auto) { return set.get(v) && f(v); });
+  }
+}
+
+// Calls f(v) on the in-neighbors v of u with values[v] < bound(), in order,
+// until f returns true. bound() is evaluated again after every call of f.
+template <class Graph, class Seq, class Bound, class F,
+          class NodeId = typename Graph::NodeId>
+void scan_in_neighbors_below(const Graph &G, NodeId u, const Seq &values,
+                             Bound &&bound, F &&f) {
+  if constexpr (has_neighbor_ids<Graph>) {
+    auto ids = G.in_neighbor_ids(u);
+    auto next = [&](size_t i) {
+      return find_first_below(values.data(), values.size(), ids.begin(), i,
+                              ids.size(), bound());
+    };
+    for (size_t i = next(0); i < ids.size() && !f(ids[i]); i = next(i + 1)) {
+    }
+  } else {
+    G.map_in_neighbors_until(
+        u, [&](NodeId v, auto) { return values[v] < bound() && f(v); });
+  }
+}
+
+// Prefetches the start of the neighbor list of u, which is scanned next
+template <class Graph, class NodeId = typename Graph::NodeId>
+void prefetch_neighbors([[maybe_unused]] const Graph &G,
+                        [[maybe_unused]] NodeId u) {
+  if constexpr (has_neighbor_ids<Graph>) {
+    if (u < G.n) {
+      __builtin_prefetch(G.neighbor_ids(u).begin());
+    }
+  }
+}
+
+template <class Graph, class NodeId = typename Graph::NodeId>
+void prefetch_in_neighbors([[maybe_unused]] const Graph &G,
+                           [[maybe_unused]] NodeId u) {
+  if constexpr (has_neighbor_ids<Graph>) {
+    if (u < G.n) {
+      __builtin_prefetch(G.in_neighbor_ids(u).begin());
+    }
+  }
+}
+
+#endif  // NEIGHBOR_SCAN_H
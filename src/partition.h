@@ -0,0 +1,79 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <algorithm>
+#include <string>
+
+#include "graph.h"
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "reorder.h"
+
+// k-way vertex partitions with balanced edge counts, e.g. to place the parts
+// of a graph on different sockets. part[v] is the part of vertex v.
+
+// Cuts order into k ranges of consecutive vertices with about m/k out-edges
+// each
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<uint32_t> partition_by_order(
+    const Graph &G, const parlay::sequence<NodeId> &order, size_t k) {
+  size_t n = G.n;
+  auto edges_before = parlay::tabulate(
+      n, [&](size_t i) -> size_t { return G.degree(order[i]); });
+  size_t total = parlay::scan_inplace(edges_before);
+  auto part = parlay::sequence<uint32_t>::uninitialized(n);
+  parlay::parallel_for(0, n, [&](size_t i) {
+    size_t p = total ? edges_before[i] * k / total : i * k / n;
+    part[order[i]] = std::min(p, k - 1);
+  });
+  return part;
+}
+
+// Keeps the clusters of a low-diameter decomposition together, so that only
+// the edges between clusters at part boundaries are cut
+template <class Graph>
+parlay::sequence<uint32_t> ldd_partition(const Graph &G, size_t k,
+                                         double beta = 0.2) {
+  return partition_by_order(G, ldd_cluster_order(G, beta), k);
+}
+
+// Parts of a graph that was relabeled by an ordering: k ranges of consecutive
+// ids with balanced edge counts
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<uint32_t> range_partition(const Graph &G, size_t k) {
+  return partition_by_order(
+      G, parlay::tabulate(G.n, [](size_t i) -> NodeId { return i; }), k);
+}
+
+// Number of edges whose endpoints are in different parts
+template <class Graph, class NodeId = typename Graph::NodeId>
+size_t num_cut_edges(const Graph &G, const parlay::sequence<uint32_t> &part) {
+  auto cut = parlay::delayed_seq<size_t>(G.n, [&](size_t u) {
+    size_t count = 0;
+    G.map_neighbors(u, [&](NodeId v, auto) { count += part[u] != part[v]; });
+    return count;
+  });
+  return parlay::reduce(cut);
+}
+
+// Number of vertices and of out-edges in each part
+template <class Graph>
+std::pair<parlay::sequence<size_t>, parlay::sequence<size_t>> part_sizes(
+    const Graph &G, const parlay::sequence<uint32_t> &part, size_t k) {
+  parlay::sequence<size_t> num_vertices(k), num_edges(k);
+  for (size_t p = 0; p < k; p++) {
+    num_vertices[p] = parlay::count(part, p);
+    num_edges[p] = parlay::reduce(parlay::delayed_seq<size_t>(
+        G.n, [&](size_t u) { return part[u] == p ? G.degree(u) : 0; }));
+  }
+  return {num_vertices, num_edges};
+}
+
+// Text file with the part of vertex i on line i
+inline void write_partition(const char *filename,
+                            const parlay::sequence<uint32_t> &part) {
+  write_permutation(filename, part);
+}
+
+#endif  // PARTITION_H
@@ -0,0 +1,80 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <algorithm>
+#include <cstddef>
+
+#include "parlay/parallel.h"
+
+// Sparse rounds visit the out-neighbors of every frontier vertex u, which
+// costs three dependent cache misses: offsets[u], the first edges of u, and
+// the distance (or label) of every neighbor. for_each_prefetched pipelines
+// them across consecutive frontier vertices: before visiting frontier[i], it
+// prefetches offsets[frontier[i + 3d]], the edges of frontier[i + 2d] and the
+// values of the first neighbors of frontier[i + d], where d is the prefetch
+// distance. By the time a vertex is visited, its edges and most of its
+// neighbors' values are in cache. Frontier vertices are processed in parallel
+// in groups of PREFETCH_GROUP_SIZE, each of which runs its own pipeline.
+//
+// The pipeline needs the CSR arrays of Graph. Other graphs, and a prefetch
+// distance of 0, run the plain loop over the frontier.
+
+constexpr size_t PREFETCH_DISTANCE = 4;
+constexpr size_t PREFETCH_GROUP_SIZE = 64;
+// neighbors whose values are prefetched per vertex
+constexpr size_t PREFETCH_MAX_EDGES = 16;
+
+template <class Graph>
+constexpr bool has_csr = requires(const Graph &G) {
+  G.offsets[0];
+  G.edges[0].v;
+};
+
+// Calls f(frontier[i]) for i in [0, size) in parallel, and prefetches the
+// neighbor lists of later frontier vertices and values[v] for their
+// neighbors v. granularity is that of the plain loop.
+template <class Graph, class Seq, class T, class F>
+void for_each_prefetched(const Graph &G, const Seq &frontier, size_t size,
+                         [[maybe_unused]] const T *values, size_t distance,
+                         F &&f, size_t granularity = 0) {
+  if constexpr (has_csr<Graph>) {
+    if (distance) {
+      size_t num_groups =
+          (size + PREFETCH_GROUP_SIZE - 1) / PREFETCH_GROUP_SIZE;
+      parlay::parallel_for(
+          0, num_groups,
+          [&](size_t g) {
+            size_t start = g * PREFETCH_GROUP_SIZE;
+            size_t end = std::min(start + PREFETCH_GROUP_SIZE, size);
+            // k runs 3 * distance steps ahead of the visited vertex i
+            for (size_t k = start; k < end + 3 * distance; k++) {
+              if (k < end) {
+                __builtin_prefetch(&G.offsets[frontier[k]]);
+              }
+              if (k >= start + distance && k - distance < end) {
+                auto u = frontier[k - distance];
+                __builtin_prefetch(&G.edges[G.offsets[u]]);
+              }
+              if (k >= start + 2 * distance && k - 2 * distance < end) {
+                auto u = frontier[k - 2 * distance];
+                size_t first = G.offsets[u];
+                size_t last = std::min<size_t>(G.offsets[u + 1],
+                                               first + PREFETCH_MAX_EDGES);
+                for (size_t j = first; j < last; j++) {
+                  __builtin_prefetch(&values[G.edges[j].v], 1);
+                }
+              }
+              if (k >= start + 3 * distance) {
+                f(frontier[k - 3 * distance]);
+              }
+            }
+          },
+          1);
+      return;
+    }
+  }
+  parlay::parallel_for(
+      0, size, [&](size_t i) { f(frontier[i]); }, granularity);
+}
+
+#endif  // PREFETCH_H
@@ -0,0 +1,359 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "BCC/ldd.h"
+#include "graph.h"
+#include "hashbag.h"
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "utils.h"
+
+// Vertex orderings that improve the locality of the accesses to per-vertex
+// arrays (distances, labels, frontier flags) made through neighbor ids.
+// reorder() returns a rank: rank[v] is the new id of vertex v, and
+// relabel() builds the graph under the new ids. Results computed on the
+// relabeled graph are mapped back to the original ids with map_back().
+enum Ordering {
+  degree_ordering = 0,
+  hub_clustering,
+  bfs_ordering,
+  rcm_ordering,
+  gorder_ordering,
+  ldd_clustering
+};
+
+inline Ordering parse_ordering(const char *name) {
+  if (!strcmp(name, "degree")) {
+    return degree_ordering;
+  } else if (!strcmp(name, "hub")) {
+    return hub_clustering;
+  } else if (!strcmp(name, "bfs")) {
+    return bfs_ordering;
+  } else if (!strcmp(name, "rcm")) {
+    return rcm_ordering;
+  } else if (!strcmp(name, "gorder")) {
+    return gorder_ordering;
+  } else if (!strcmp(name, "ldd")) {
+    return ldd_clustering;
+  }
+  std::cerr << "Error: Unknown ordering " << name << std::endl;
+  abort();
+}
+
+// Turns an order (order[i] is the i-th vertex) into a rank and vice versa
+template <class NodeId>
+parlay::sequence<NodeId> inverse_permutation(
+    const parlay::sequence<NodeId> &perm) {
+  auto inverse = parlay::sequence<NodeId>::uninitialized(perm.size());
+  parlay::parallel_for(0, perm.size(),
+                       [&](size_t i) { inverse[perm[i]] = i; });
+  return inverse;
+}
+
+// Calls f(v) on the out-neighbors of u, and also on its in-neighbors if G is
+// directed and has an in-CSR
+template <class Graph, class F>
+void map_adjacent(const Graph &G, typename Graph::NodeId u, F &&f) {
+  using NodeId = typename Graph::NodeId;
+  G.map_neighbors(u, [&](NodeId v, auto) { f(v); });
+  if (!G.symmetrized && G.in_offsets.size() == G.n + 1) {
+    G.map_in_neighbors_until(u, [&](NodeId v, auto) {
+      f(v);
+      return false;
+    });
+  }
+}
+
+// Vertices by decreasing degree, ties broken by id
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<NodeId> degree_order(const Graph &G) {
+  auto order = parlay::tabulate(G.n, [](size_t i) -> NodeId { return i; });
+  parlay::sort_inplace(order, [&](NodeId a, NodeId b) {
+    size_t deg_a = G.degree(a), deg_b = G.degree(b);
+    return deg_a > deg_b || (deg_a == deg_b && a < b);
+  });
+  return order;
+}
+
+// Vertices with more than average degree first, each group in its original
+// order [Balaji and Lucia, IISWC'18]
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<NodeId> hub_cluster_order(const Graph &G) {
+  double avg_degree = 1.0 * G.m / G.n;
+  auto ids = parlay::tabulate(G.n, [](size_t i) -> NodeId { return i; });
+  auto order =
+      parlay::filter(ids, [&](NodeId u) { return G.degree(u) > avg_degree; });
+  order.append(parlay::filter(
+      ids, [&](NodeId u) { return G.degree(u) <= avg_degree; }));
+  return order;
+}
+
+// Level-synchronous Cuthill-McKee. Every unvisited vertex of least degree
+// starts a search; the vertices of each BFS level are ordered by the rank of
+// their first-ordered parent and then, if by_degree, by increasing degree.
+// Levels are discovered and sorted in parallel. Edges are followed in both
+// directions when the in-CSR of a directed graph is available.
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<NodeId> cuthill_mckee_order(const Graph &G,
+                                             bool by_degree = true) {
+  constexpr NodeId NODE_MAX = std::numeric_limits<NodeId>::max();
+  size_t n = G.n;
+  auto rank = parlay::sequence<NodeId>::uninitialized(n);
+  parlay::sequence<NodeId> key(n, NODE_MAX);
+  parlay::sequence<bool> visited(n, false);
+  auto order = parlay::sequence<NodeId>::uninitialized(n);
+  hashbag<NodeId> bag(n);
+
+  auto roots = parlay::tabulate(n, [](size_t i) -> NodeId { return i; });
+  parlay::sort_inplace(roots, [&](NodeId a, NodeId b) {
+    size_t deg_a = G.degree(a), deg_b = G.degree(b);
+    return deg_a < deg_b || (deg_a == deg_b && a < b);
+  });
+  size_t num_ordered = 0;
+  for (size_t r = 0; r < n; r++) {
+    NodeId s = roots[r];
+    if (visited[s]) {
+      continue;
+    }
+    visited[s] = true;
+    rank[s] = num_ordered;
+    order[num_ordered++] = s;
+    size_t level_start = num_ordered - 1;
+    while (level_start < num_ordered) {
+      auto frontier = order.cut(level_start, num_ordered);
+      parlay::parallel_for(
+          0, frontier.size(),
+          [&](size_t i) {
+            NodeId u = frontier[i];
+            map_adjacent(G, u, [&](NodeId v) {
+              if (!visited[v]) {
+                write_min(&key[v], rank[u]);
+              }
+            });
+          },
+          1);
+      parlay::parallel_for(
+          0, frontier.size(),
+          [&](size_t i) {
+            NodeId u = frontier[i];
+            map_adjacent(G, u, [&](NodeId v) {
+              if (key[v] == rank[u] &&
+                  compare_and_swap(&visited[v], false, true)) {
+                bag.insert(v);
+              }
+            });
+          },
+          1);
+      size_t level_size = bag.pack_into(order.cut(num_ordered, n));
+      auto level = order.cut(num_ordered, num_ordered + level_size);
+      parlay::sort_inplace(level, [&](NodeId a, NodeId b) {
+        if (key[a] != key[b]) {
+          return key[a] < key[b];
+        }
+        if (by_degree && G.degree(a) != G.degree(b)) {
+          return G.degree(a) < G.degree(b);
+        }
+        return a < b;
+      });
+      parlay::parallel_for(0, level_size, [&](size_t i) {
+        rank[level[i]] = num_ordered + i;
+      });
+      level_start = num_ordered;
+      num_ordered += level_size;
+    }
+  }
+  return order;
+}
+
+// Gorder-style greedy ordering [Wei et al., SIGMOD'16]. The next vertex is
+// the one sharing the most neighbors and in-neighbors with the last WINDOW
+// placed vertices. To run in parallel, the RCM order is cut into chunks of
+// CHUNK_SIZE vertices that are ordered independently, and common neighbors
+// through vertices of degree more than MAX_SIBLING_DEGREE are not counted.
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<NodeId> gorder_order(const Graph &G) {
+  constexpr size_t WINDOW = 5;
+  constexpr size_t CHUNK_SIZE = 1 << 14;
+  constexpr size_t MAX_SIBLING_DEGREE = 64;
+  size_t n = G.n;
+  auto base = cuthill_mckee_order(G);
+  std::reverse(base.begin(), base.end());
+  auto pos = inverse_permutation(base);
+  parlay::sequence<int> score(n, 0);
+  parlay::sequence<bool> placed(n, false);
+  auto order = parlay::sequence<NodeId>::uninitialized(n);
+
+  size_t num_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  parlay::parallel_for(
+      0, num_chunks,
+      [&](size_t c) {
+        size_t start = c * CHUNK_SIZE;
+        size_t end = std::min(start + CHUNK_SIZE, n);
+        // Buckets of vertices by score. Entries are not removed when a score
+        // changes, so they are checked when popped.
+        std::vector<std::vector<NodeId>> buckets(1);
+        size_t max_score = 0;
+        auto bump = [&](NodeId v, int delta) {
+          if (pos[v] < start || pos[v] >= end || placed[v]) {
+            return;
+          }
+          score[v] += delta;
+          if (score[v] > 0) {
+            if ((size_t)score[v] >= buckets.size()) {
+              buckets.resize(score[v] + 1);
+            }
+            buckets[score[v]].push_back(v);
+            max_score = std::max(max_score, (size_t)score[v]);
+          }
+        };
+        auto update = [&](NodeId u, int delta) {
+          map_adjacent(G, u, [&](NodeId v) {
+            bump(v, delta);
+            if (G.degree(v) <= MAX_SIBLING_DEGREE) {
+              G.map_neighbors(v, [&](NodeId x, auto) {
+                if (x != u) {
+                  bump(x, delta);
+                }
+              });
+            }
+          });
+        };
+        size_t scan = start;
+        for (size_t i = start; i < end; i++) {
+          NodeId u = NodeId(-1);
+          while (max_score > 0) {
+            auto &bucket = buckets[max_score];
+            if (bucket.empty()) {
+              max_score--;
+              continue;
+            }
+            NodeId v = bucket.back();
+            bucket.pop_back();
+            if (!placed[v] && (size_t)score[v] == max_score) {
+              u = v;
+              break;
+            }
+          }
+          if (u == NodeId(-1)) {
+            while (placed[base[scan]]) {
+              scan++;
+            }
+            u = base[scan];
+          }
+          placed[u] = true;
+          order[i] = u;
+          update(u, 1);
+          if (i >= start + WINDOW) {
+            update(order[i - WINDOW], -1);
+          }
+        }
+      },
+      1);
+  return order;
+}
+
+// The clusters of a low-diameter decomposition (see BCC/ldd.h) one after
+// another, each in increasing order of ids. Every vertex may become a center,
+// so clusters have diameter O(log n / beta) and about a beta fraction of the
+// edges run between clusters. Needs the in-CSR of directed graphs.
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<NodeId> ldd_cluster_order(const Graph &G, double beta) {
+  LDD solver(G);
+  auto label = std::get<0>(solver.ldd(beta, false, G.n));
+  auto order = parlay::tabulate(G.n, [](size_t i) -> NodeId { return i; });
+  parlay::sort_inplace(order, [&](NodeId a, NodeId b) {
+    return label[a] < label[b] || (label[a] == label[b] && a < b);
+  });
+  return order;
+}
+
+// beta is only used by ldd_clustering
+template <class Graph, class NodeId = typename Graph::NodeId>
+parlay::sequence<NodeId> reorder(const Graph &G, Ordering ordering,
+                                 double beta = 0.2) {
+  parlay::sequence<NodeId> order;
+  if (ordering == degree_ordering) {
+    order = degree_order(G);
+  } else if (ordering == hub_clustering) {
+    order = hub_cluster_order(G);
+  } else if (ordering == bfs_ordering) {
+    order = cuthill_mckee_order(G, false);
+  } else if (ordering == rcm_ordering) {
+    order = cuthill_mckee_order(G);
+    std::reverse(order.begin(), order.end());
+  } else if (ordering == gorder_ordering) {
+    order = gorder_order(G);
+  } else {
+    order = ldd_cluster_order(G, beta);
+  }
+  return inverse_permutation(order);
+}
+
+// The graph with vertex v renamed to rank[v]. Neighbor lists are sorted: the
+// renamed edges are grouped by target first, and then by source in the order
+// of their targets, with two stable counting sorts.
+template <class Graph, class NodeId = typename Graph::NodeId>
+Graph relabel(const Graph &G, const parlay::sequence<NodeId> &rank) {
+  using EdgeId = typename Graph::EdgeId;
+  using Edge = typename Graph::Edge;
+  Graph H;
+  H.n = G.n;
+  H.m = G.m;
+  H.symmetrized = G.symmetrized;
+  H.weighted = G.weighted;
+  // The in-lists of H, which hold the renamed sources
+  auto [in_offsets, in_edges] = csr_from_edges<EdgeId, Edge>(
+      G.n, G.m, [&](size_t begin, size_t end, auto &&f) {
+        for_csr_range(G.offsets, G.n, begin, end, [&](NodeId u, size_t i) {
+          f(rank[G.edges[i].v], Edge(rank[u], G.edges[i].w));
+        });
+      });
+  std::tie(H.offsets, H.edges) = csr_from_edges<EdgeId, Edge>(
+      G.n, G.m, [&](size_t begin, size_t end, auto &&f) {
+        for_csr_range(in_offsets, G.n, begin, end, [&](NodeId v, size_t i) {
+          f(in_edges[i].v, Edge(v, in_edges[i].w));
+        });
+      });
+  return H;
+}
+
+// Values indexed by new ids to values indexed by original ids
+template <class T, class NodeId>
+parlay::sequence<T> map_back(const parlay::sequence<T> &values,
+                             const parlay::sequence<NodeId> &rank) {
+  return parlay::tabulate(rank.size(),
+                          [&](size_t v) -> T { return values[rank[v]]; });
+}
+
+// Text file with the new id of vertex i on line i
+template <class NodeId>
+void write_permutation(const char *filename,
+                       const parlay::sequence<NodeId> &rank) {
+  auto chars = parlay::flatten(parlay::tabulate(rank.size() * 2, [&](size_t i) {
+    if (i % 2 == 0) {
+      return parlay::to_chars(rank[i / 2]);
+    } else {
+      return parlay::to_chars('\n');
+    }
+  }));
+  chars_to_file(chars, std::string(filename));
+}
+
+template <class NodeId>
+parlay::sequence<NodeId> read_permutation(const char *filename) {
+  auto chars = parlay::chars_from_file(std::string(filename));
+  auto tokens = parlay::tokens(chars);
+  return parlay::tabulate(tokens.size(), [&](size_t i) -> NodeId {
+    return parse_number<NodeId>(std::string_view(tokens[i].data(),
+                                                 tokens[i].size()));
+  });
+}
+
+#endif  // REORDER_H
@@ -2,12 +2,37 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 
+// Sequence lock that guards objects wider than 8 bytes at address a. A
+// compare-and-swap makes the counter odd while it compares and writes, and
+// atomic_read retries when the counter was odd or changed during its read,
+// so readers never see a half-written object and never write the lock.
+inline std::atomic<uint64_t> &wide_seqlock(const void *a) {
+  static constexpr size_t NUM_LOCKS = 1 << 12;
+  static std::atomic<uint64_t> locks[NUM_LOCKS];
+  return locks[(reinterpret_cast<uintptr_t>(a) >> 4) % NUM_LOCKS];
+}
+
+// Copies the words of an object wider than 8 bytes with relaxed atomic
+// accesses, which may interleave with those of a concurrent writer
+template <typename ET>
+inline void copy_words(ET *dst, const ET *src) {
+  static_assert(sizeof(ET) % 8 == 0 && alignof(ET) >= 8,
+                "Wide objects must consist of aligned 8-byte words");
+  auto *d = reinterpret_cast<uint64_t *>(dst);
+  auto *s = reinterpret_cast<const uint64_t *>(src);
+  for (size_t i = 0; i < sizeof(ET) / 8; i++) {
+    __atomic_store_n(d + i, __atomic_load_n(s + i, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+  }
+}
+
 template <typename ET>
 inline bool atomic_compare_and_swap(ET *a, ET oldval, ET newval) {
-  static_assert(sizeof(ET) <= 8, "Bad CAS length");
   if constexpr (sizeof(ET) == 1) {
     uint8_t r_oval, r_nval;
     std::memcpy(&r_oval, &oldval, sizeof(ET));
@@ -27,8 +52,52 @@ inline bool atomic_compare_and_swap(ET *a, ET oldval, ET newval) {
     return __sync_bool_compare_and_swap(reinterpret_cast<uint64_t *>(a), r_oval,
                                         r_nval);
   } else {
-    std::cerr << "Bad CAS length" << std::endl;
+    // Wider objects, such as pairs of 64-bit vertex ids in hash tables, are
+    // only 8-byte aligned in sequences, so they cannot use a double-width CAS
+    // and are swapped under a sequence lock instead. Concurrent reads of them
+    // must go through atomic_read.
+    static_assert(sizeof(ET) > 8, "Bad CAS length");
+    std::atomic<uint64_t> &lock = wide_seqlock(a);
+    uint64_t version = lock.load(std::memory_order_relaxed);
+    while ((version & 1) ||
+           !lock.compare_exchange_weak(version, version + 1,
+                                       std::memory_order_acquire)) {
+      version = lock.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    ET current;
+    copy_words(&current, a);
+    bool swapped = std::memcmp(&current, &oldval, sizeof(ET)) == 0;
+    if (swapped) {
+      copy_words(a, &newval);
+    }
+    lock.store(version + 2, std::memory_order_release);
+    return swapped;
+  }
+}
+
+// Reads *a atomically with respect to atomic_compare_and_swap, which writes
+// objects wider than 8 bytes in several stores
+template <typename ET>
+inline ET atomic_read(const ET *a) {
+  ET value;
+  if constexpr (sizeof(ET) <= 8) {
+    __atomic_load(a, &value, __ATOMIC_RELAXED);
+  } else {
+    std::atomic<uint64_t> &lock = wide_seqlock(a);
+    while (true) {
+      uint64_t version = lock.load(std::memory_order_acquire);
+      if (version & 1) {
+        continue;
+      }
+      copy_words(&value, a);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (lock.load(std::memory_order_relaxed) == version) {
+        return value;
+      }
+    }
   }
+  return value;
 }
 
 template <class ET>
@@ -71,6 +140,16 @@ inline bool write_min(ET *a, ET b, F less = {}) {
   return r;
 }
 
+// Like write_min, but returns the value of *a before the write, or the
+// current value if it is not larger than b
+template <typename ET, typename F = std::less<ET>>
+inline ET fetch_and_min(ET *a, ET b, F less = {}) {
+  ET c;
+  do c = *a;
+  while (less(b, c) && !atomic_compare_and_swap(a, c, b));
+  return c;
+}
+
 template <typename ET, typename F = std::less<ET>>
 inline bool write_max(ET *a, ET b, F less = {}) {
   ET c;
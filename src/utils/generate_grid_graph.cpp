@@ -51,16 +51,18 @@ Graph<NodeId, EdgeId> generate_grid(size_t row, size_t col, double rate) {
   G.n = n;
   G.m = m;
   printf("n: %zu, m: %zu\n", n, m);
-  G.offsets = sequence<EdgeId>(n + 1, m);
-  G.edges = sequence<Edge>(m);
+  auto offsets = sequence<EdgeId>(n + 1, m);
+  auto edges = sequence<Edge>(m);
   parallel_for(0, m, [&](size_t i) {
-    G.edges[i].v = edgelist[i].second;
+    edges[i].v = edgelist[i].second;
     if (i == 0 || edgelist[i].first != edgelist[i - 1].first) {
-      G.offsets[edgelist[i].first] = i;
+      offsets[edgelist[i].first] = i;
     }
   });
-  scan_inclusive_inplace(make_slice((G.offsets).rbegin(), (G.offsets).rend()),
+  scan_inclusive_inplace(make_slice(offsets.rbegin(), offsets.rend()),
                          minm<EdgeId>());
+  G.offsets = std::move(offsets);
+  G.edges = std::move(edges);
   return G;
 }
 
@@ -0,0 +1,117 @@
+#include <type_traits>
+
+#include "graph.h"
+
+constexpr size_t NUM_VERTICES = 1000;
+constexpr size_t NUM_EDGES = 20000;
+
+// Writes a random graph of type From and reads it back as type To, which may
+// use other widths for vertex ids, edge ids and weights, and checks that the
+// structure and weights are preserved
+template <class From, class To>
+void round_trip(const char *filename, bool weighted, bool symmetrized) {
+  From G;
+  G.symmetrized = symmetrized;
+  G.generate_random_graph(NUM_VERTICES, NUM_EDGES);
+  if constexpr (!std::is_same_v<typename From::EdgeTy, Empty>) {
+    if (weighted) {
+      G.generate_random_weight(1, 1 << 10);
+    }
+  }
+  G.write_binary_format(filename);
+
+  To H;
+  H.symmetrized = symmetrized;
+  H.read_graph(filename);
+  printf("%zu-bit ids %s -> %zu-bit ids: ", sizeof(typename From::NodeId) * 8,
+         weighted ? "weighted" : "unweighted",
+         sizeof(typename To::NodeId) * 8);
+  assert(H.n == G.n && H.m == G.m);
+  for (size_t u = 0; u <= G.n; u++) {
+    assert(H.offsets[u] == G.offsets[u]);
+  }
+  for (size_t i = 0; i < G.m; i++) {
+    assert(H.edges[i].v == G.edges[i].v);
+  }
+  constexpr bool has_weights =
+      !std::is_same_v<typename From::EdgeTy, Empty> &&
+      !std::is_same_v<typename To::EdgeTy, Empty>;
+  if constexpr (has_weights) {
+    assert(H.weighted == weighted);
+    if (weighted) {
+      for (size_t i = 0; i < G.m; i++) {
+        assert(H.edges[i].w == G.edges[i].w);
+      }
+    }
+  } else {
+    assert(!H.weighted);
+  }
+  printf("Passed!\n");
+}
+
+// Every combination of 32- and 64-bit vertex ids on both sides, with the
+// weight type W, so that mapped and converted reads are both covered
+template <class W>
+void round_trips(const char *filename, bool weighted, bool symmetrized) {
+  round_trip<Graph<uint32_t, uint64_t, W>, Graph<uint32_t, uint64_t, W>>(
+      filename, weighted, symmetrized);
+  round_trip<Graph<uint32_t, uint64_t, W>, Graph<uint64_t, uint64_t, W>>(
+      filename, weighted, symmetrized);
+  round_trip<Graph<uint64_t, uint64_t, W>, Graph<uint32_t, uint64_t, W>>(
+      filename, weighted, symmetrized);
+  round_trip<Graph<uint64_t, uint64_t, W>, Graph<uint64_t, uint64_t, W>>(
+      filename, weighted, symmetrized);
+  round_trip<Graph<uint64_t, uint32_t, W>, Graph<uint32_t, uint64_t, W>>(
+      filename, weighted, symmetrized);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc == 1) {
+    fprintf(stderr,
+            "Usage: %s [-o output_file] [-s]\n"
+            "Options:\n"
+            "\t-o,\tpath of the file written and read by the tests\n"
+            "\t-s,\tsymmetrized graphs\n",
+            argv[0]);
+    return 0;
+  }
+  char c;
+  char const *output_path = nullptr;
+  bool symmetrized = false;
+  while ((c = getopt(argc, argv, "o:s")) != -1) {
+    switch (c) {
+      case 'o':
+        output_path = optarg;
+        break;
+      case 's':
+        symmetrized = true;
+        break;
+      default:
+        std::cerr << "Error: Unknown option " << optopt << std::endl;
+        abort();
+    }
+  }
+  if (!output_path) {
+    std::cerr << "Error: No output file given" << std::endl;
+    abort();
+  }
+
+  printf("Unweighted graphs\n");
+  round_trips<Empty>(output_path, false, symmetrized);
+  printf("Unweighted graphs with a weight field\n");
+  round_trips<uint32_t>(output_path, false, symmetrized);
+  printf("32-bit weights\n");
+  round_trips<uint32_t>(output_path, true, symmetrized);
+  printf("16-bit weights\n");
+  round_trips<uint16_t>(output_path, true, symmetrized);
+  printf("Floating-point weights\n");
+  round_trips<float>(output_path, true, symmetrized);
+  round_trip<Graph<uint32_t, uint64_t, uint32_t>,
+             Graph<uint64_t, uint64_t, uint16_t>>(output_path, true,
+                                                  symmetrized);
+  round_trip<Graph<uint64_t, uint64_t, uint16_t>,
+             Graph<uint32_t, uint64_t, uint64_t>>(output_path, true,
+                                                  symmetrized);
+  remove(output_path);
+  return 0;
+}
@@ -1,20 +1,39 @@
 #include "graph.h"
 
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
+typedef uint32_t NodeId;
+#endif
+typedef uint64_t EdgeId;
+
+template <class Graph>
+void convert(char const* input_path, char const* output_path) {
+  printf("Reading graph...\n");
+  Graph G;
+  G.read_graph(input_path);
+  G.write_binary_format(output_path);
+}
+
 int main(int argc, char* argv[]) {
   if (argc == 1) {
     fprintf(stderr,
-            "Usage: %s [-i input_file] [-o output file] [-w]\n"
+            "Usage: %s [-i input_file] [-o output file] [-w] [-f]\n"
             "Options:\n"
             "\t-i,\tinput file path\n"
-            "\t-o,\toutput file path\n",
+            "\t-o,\toutput file path\n"
+            "\t-w,\tkeep integral edge weights\n"
+            "\t-f,\tkeep floating-point edge weights\n",
             argv[0]);
     return 0;
   }
 
   char const* input_path = nullptr;
   char const* output_path = nullptr;
+  bool integral_weights = false;
+  bool float_weights = false;
   char c;
-  while ((c = getopt(argc, argv, "i:o:")) != -1) {
+  while ((c = getopt(argc, argv, "i:o:wf")) != -1) {
     switch (c) {
       case 'i':
         input_path = optarg;
@@ -22,14 +41,23 @@ int main(int argc, char* argv[]) {
       case 'o':
         output_path = optarg;
         break;
+      case 'w':
+        integral_weights = true;
+        break;
+      case 'f':
+        float_weights = true;
+        break;
       default:
         std::cerr << "Error: Unknown option " << optopt << std::endl;
         abort();
     }
   }
-  printf("Reading graph...\n");
-  Graph G;
-  G.read_graph(input_path);
-  G.write_binary_format(output_path);
+  if (integral_weights) {
+    convert<Graph<NodeId, EdgeId, uint32_t>>(input_path, output_path);
+  } else if (float_weights) {
+    convert<Graph<NodeId, EdgeId, float>>(input_path, output_path);
+  } else {
+    convert<Graph<NodeId, EdgeId>>(input_path, output_path);
+  }
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,137 @@
+#include "reorder.h"
+
+#include <string>
+
+#include "graph.h"
+#include "partition.h"
+
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
+typedef uint32_t NodeId;
+#endif
+typedef uint64_t EdgeId;
+
+template <class Graph>
+void reorder_graph(char const* input_path, char const* output_path,
+                   char const* perm_path, Ordering ordering, double beta,
+                   size_t num_parts, bool symmetrized) {
+  printf("Reading graph...\n");
+  Graph G;
+  G.read_graph(input_path);
+  G.symmetrized = symmetrized;
+  if (!G.symmetrized &&
+      (ordering == bfs_ordering || ordering == rcm_ordering ||
+       ordering == gorder_ordering || ordering == ldd_clustering)) {
+    G.make_inverse(input_path);
+  }
+
+  printf("Reordering graph...\n");
+  parlay::internal::timer t;
+  auto rank = reorder(G, ordering, beta);
+  printf("Permutation: %f\n", t.next_time());
+  G = relabel(G, rank);
+  printf("Relabel: %f\n", t.next_time());
+
+  G.write_binary_format(output_path);
+  std::string default_perm_path = std::string(output_path) + ".perm";
+  write_permutation(perm_path ? perm_path : default_perm_path.c_str(), rank);
+
+  if (num_parts) {
+    // Parts are ranges of the new ids, so the clusters of the ordering stay
+    // together
+    auto part = range_partition(G, num_parts);
+    auto [num_vertices, num_edges] = part_sizes(G, part, num_parts);
+    size_t start = 0;
+    for (size_t p = 0; p < num_parts; p++) {
+      printf("Part %zu: vertices [%zu, %zu), %zu edges\n", p, start,
+             start + num_vertices[p], num_edges[p]);
+      start += num_vertices[p];
+    }
+    size_t cut = num_cut_edges(G, part);
+    printf("Cut edges: %zu (%.2f%%)\n", cut, 100.0 * cut / G.m);
+    write_partition((std::string(output_path) + ".part").c_str(), part);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 1) {
+    fprintf(stderr,
+            "Usage: %s [-i input_file] [-o output file] [-a ordering] "
+            "[-p permutation_file] [-b beta] [-k num_parts] [-s] [-w] [-f]\n"
+            "Options:\n"
+            "\t-i,\tinput file path\n"
+            "\t-o,\toutput file path\n"
+            "\t-a,\tordering: [degree] [hub] [bfs] [rcm] [gorder] [ldd] "
+            "(default: rcm)\n"
+            "\t-p,\tfile to write the new id of every vertex to (default: "
+            "output file path + .perm)\n"
+            "\t-b,\tbeta of the ldd ordering (default: 0.2)\n"
+            "\t-k,\talso split the output graph into k parts with balanced "
+            "edge counts, written to output file path + .part\n"
+            "\t-s,\tsymmetrized input graph\n"
+            "\t-w,\tkeep integral edge weights\n"
+            "\t-f,\tkeep floating-point edge weights\n",
+            argv[0]);
+    return 0;
+  }
+
+  char const* input_path = nullptr;
+  char const* output_path = nullptr;
+  char const* perm_path = nullptr;
+  Ordering ordering = rcm_ordering;
+  double beta = 0.2;
+  size_t num_parts = 0;
+  bool symmetrized = false;
+  bool integral_weights = false;
+  bool float_weights = false;
+  char c;
+  while ((c = getopt(argc, argv, "i:o:a:p:b:k:swf")) != -1) {
+    switch (c) {
+      case 'i':
+        input_path = optarg;
+        break;
+      case 'o':
+        output_path = optarg;
+        break;
+      case 'a':
+        ordering = parse_ordering(optarg);
+        break;
+      case 'p':
+        perm_path = optarg;
+        break;
+      case 'b':
+        beta = atof(optarg);
+        break;
+      case 'k':
+        num_parts = atol(optarg);
+        break;
+      case 's':
+        symmetrized = true;
+        break;
+      case 'w':
+        integral_weights = true;
+        break;
+      case 'f':
+        float_weights = true;
+        break;
+      default:
+        std::cerr << "Error: Unknown option " << optopt << std::endl;
+        abort();
+    }
+  }
+  if (integral_weights) {
+    reorder_graph<Graph<NodeId, EdgeId, uint32_t>>(
+        input_path, output_path, perm_path, ordering, beta, num_parts,
+        symmetrized);
+  } else if (float_weights) {
+    reorder_graph<Graph<NodeId, EdgeId, float>>(
+        input_path, output_path, perm_path, ordering, beta, num_parts,
+        symmetrized);
+  } else {
+    reorder_graph<Graph<NodeId, EdgeId>>(input_path, output_path, perm_path,
+                                         ordering, beta, num_parts,
+                                         symmetrized);
+  }
+  return 0;
+}
@@ -1,6 +1,10 @@
 #include "graph.h"
 
+#ifdef NODE64
+typedef uint64_t NodeId;
+#else
 typedef uint32_t NodeId;
+#endif
 typedef uint64_t EdgeId;
 typedef float EdgeTy;
 